@@ -1,6 +1,8 @@
 #ifndef AUTONNIC_WIND_SRC_AUTONNIC_A5120_PARSER_H_
 #define AUTONNIC_WIND_SRC_AUTONNIC_A5120_PARSER_H_
 
+#include <atomic>
+
 #include "sensesp.h"
 #include "sensesp/system/observablevalue.h"
 #include "sensesp/system/valueconsumer.h"
@@ -10,8 +12,18 @@
 
 namespace wind_interface {
 
+/**
+ * @brief Parser for the A5120 command responses, $PATC,WIMWV,ACK or NAK.
+ *
+ * The responses do not identify the command they answer. Commands sent
+ * with send_command() are numbered, and since the sensor answers them in
+ * order, each response is matched to the oldest unanswered command.
+ */
 class AutonnicPATCWIMWVParser : public sensesp::nmea0183::SentenceParser {
  public:
+  // A command not answered within this time is considered lost, in ms
+  static constexpr uint32_t kResponseTimeout = 1000;
+
   AutonnicPATCWIMWVParser(sensesp::nmea0183::NMEA0183Parser *nmea0183)
       : SentenceParser(nmea0183) {
     ignore_checksum(true);
@@ -19,6 +31,30 @@ class AutonnicPATCWIMWVParser : public sensesp::nmea0183::SentenceParser {
 
   inline virtual const char *sentence_address() override final { return "PATC,WIMWV"; }
 
+  /**
+   * @brief Send a command to the sensor.
+   *
+   * @return Sequence number of the command; see answered_command()
+   */
+  uint32_t send_command(sensesp::nmea0183::NMEA0183IOTask *nmea_io_task,
+                        const String &sentence) {
+    uint32_t now = millis();
+    if (now - last_command_ms_ > kResponseTimeout) {
+      // Outstanding commands have timed out; don't wait for their responses
+      responses_ = commands_.load();
+    }
+    last_command_ms_ = now;
+    uint32_t command = ++commands_;
+    nmea_io_task->set(sentence);
+    return command;
+  }
+
+  /// Sequence number of the command answered by the latest response
+  uint32_t answered_command() const { return answered_command_; }
+
+  /// True if the latest response was an ACK
+  bool is_ack() const { return ack_; }
+
   inline bool parse_fields(const char *field_strings, const int field_offsets[],
                     int num_fields) override final {
     String response;
@@ -32,6 +68,11 @@ class AutonnicPATCWIMWVParser : public sensesp::nmea0183::SentenceParser {
     bool ok = sensesp::nmea0183::ParseString(&response,
                                              field_strings + field_offsets[2]);
 
+    if (responses_ < commands_) {
+      responses_++;
+    }
+    answered_command_ = responses_;
+    ack_ = ok && response == "ACK";
     response_.set(response);
 
     ESP_LOGV("AutonnicPATCWIMWVParser", "Response: %s", response.c_str());
@@ -41,6 +82,14 @@ class AutonnicPATCWIMWVParser : public sensesp::nmea0183::SentenceParser {
   }
 
   sensesp::ObservableValue<String> response_;
+
+ protected:
+  // Commands may be sent from other tasks than the one parsing responses
+  std::atomic<uint32_t> commands_{0};
+  std::atomic<uint32_t> responses_{0};
+  std::atomic<uint32_t> last_command_ms_{0};
+  uint32_t answered_command_ = 0;
+  bool ack_ = false;
 };
 
 }  // namespace wind_interface
@@ -97,8 +97,9 @@ class ReferenceAngleConfig : public sensesp::FileSystemSaveable,
     response_semaphore_.clear();
     // Indirection using onDelay ensures the command is sent from the event loop
     // thread and does not interfere with any other serial communication.
-    sensesp::event_loop()->onDelay(
-        0, [this, sentence]() { nmea_io_task_->set(sentence); });
+    sensesp::event_loop()->onDelay(0, [this, sentence]() {
+      response_parser_->send_command(nmea_io_task_, sentence);
+    });
     if (!response_semaphore_.take(1000)) {
       return false;
     }
@@ -164,8 +165,9 @@ class WindDirectionDampingConfig : public sensesp::FileSystemSaveable,
     ESP_LOGD("WindDirectionDampingConfig", "Sending sentence: %s",
              sentence.c_str());
     response_semaphore_.clear();
-    sensesp::event_loop()->onDelay(
-        0, [this, sentence]() { nmea_io_task_->set(sentence); });
+    sensesp::event_loop()->onDelay(0, [this, sentence]() {
+      response_parser_->send_command(nmea_io_task_, sentence);
+    });
     if (!response_semaphore_.take(1000)) {
       return false;
     }
@@ -236,8 +238,9 @@ class WindSpeedDampingConfig : public sensesp::FileSystemSaveable,
     ESP_LOGD("WindSpeedDampingConfig", "Sending sentence: %s",
              sentence.c_str());
     response_semaphore_.clear();
-    sensesp::event_loop()->onDelay(
-        0, [this, sentence]() { nmea_io_task_->set(sentence); });
+    sensesp::event_loop()->onDelay(0, [this, sentence]() {
+      response_parser_->send_command(nmea_io_task_, sentence);
+    });
     if (!response_semaphore_.take(1000)) {
       return false;
     }
@@ -308,7 +311,8 @@ class WindOutputRepetitionRateConfig : public sensesp::FileSystemSaveable,
     ESP_LOGD("WindOutputRepetitionRate", "Sending sentence: %s",
              sentence.c_str());
     response_semaphore_.clear();
-    nmea_io_task_->set(sentence);  // Queue the command
+    // Queue the command
+    response_parser_->send_command(nmea_io_task_, sentence);
     // Wait until the response is received
     if (!response_semaphore_.take(5000)) {
       ESP_LOGE("WindOutputRepetitionRate", "No response received");
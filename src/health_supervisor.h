@@ -0,0 +1,292 @@
+#ifndef AUTONNIC_WIND_SRC_HEALTH_SUPERVISOR_H_
+#define AUTONNIC_WIND_SRC_HEALTH_SUPERVISOR_H_
+
+#include <ESP32_CAN_regdef.h>
+#include <NMEA2000_esp32.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "sensesp.h"
+#include "sensesp/system/observablevalue.h"
+
+namespace wind_interface {
+
+/**
+ * @brief tNMEA2000_esp32 with access to the CAN controller state.
+ *
+ * The NMEA2000_esp32 driver programs the ESP32 CAN (TWAI) controller
+ * registers directly, so bus-off detection and recovery are done at the
+ * register level as well.
+ */
+class RecoverableNMEA2000 : public tNMEA2000_esp32 {
+ public:
+  RecoverableNMEA2000(gpio_num_t tx_pin, gpio_num_t rx_pin)
+      : tNMEA2000_esp32(tx_pin, rx_pin) {}
+
+  bool is_bus_off() const { return MODULE_CAN->SR.B.BS; }
+
+  int get_tx_error_count() const { return MODULE_CAN->TXERR.U; }
+
+  /// True while a frame is waiting in the controller transmit buffer
+  bool is_tx_pending() const { return !MODULE_CAN->SR.B.TBS; }
+
+  /**
+   * @brief Recover the CAN controller without reinitializing the driver.
+   *
+   * After bus-off, the controller enters reset mode by itself and leaving
+   * reset mode starts the bus-off recovery sequence (128 x 11 recessive
+   * bits, a few milliseconds at 250 kbit/s). For a stalled transmitter,
+   * the pending transmission is aborted first. The address claims of all
+   * devices are repeated so that other nodes re-learn our source
+   * addresses.
+   */
+  void recover() {
+    if (!MODULE_CAN->MOD.B.RM) {
+      MODULE_CAN->CMR.B.AT = 1;
+      MODULE_CAN->MOD.B.RM = 1;
+    }
+    MODULE_CAN->MOD.B.RM = 0;
+    for (int i = 0; i < DeviceCount; i++) {
+      SendIsoAddressClaim(0xff, i);
+    }
+  }
+};
+
+/**
+ * @brief Fault detection and recovery state for a single supervised link.
+ */
+class SupervisedLink {
+ public:
+  /**
+   * @param name Human readable link name
+   * @param timeout Maximum time without activity, in ms
+   * @param reboot_on_fault Whether a persistent fault of this link may
+   * restart the device
+   */
+  SupervisedLink(String name, unsigned long timeout, bool reboot_on_fault)
+      : name_{name}, timeout_{timeout}, reboot_on_fault_{reboot_on_fault} {}
+
+  /// Mark the link as alive. Call whenever the link has delivered data.
+  void feed() { last_activity_ = millis(); }
+
+  /// Mark all activity conditions as fresh, e.g. at the start of supervision
+  virtual void reset_activity() { feed(); }
+
+  void set_timeout(unsigned long timeout) { timeout_ = timeout; }
+
+  const String& get_name() const { return name_; }
+
+  /// Number of in-place recovery attempts
+  sensesp::ObservableValue<int> recoveries_ = 0;
+
+ protected:
+  friend class HealthSupervisor;
+
+  virtual bool is_faulty() { return millis() - last_activity_ > timeout_; }
+  virtual void recover() = 0;
+
+  String name_;
+  unsigned long timeout_;
+  bool reboot_on_fault_;
+  unsigned long last_activity_ = 0;
+
+  bool in_fault_ = false;
+  unsigned long fault_detected_ = 0;  // millis() when the fault was detected
+  unsigned long next_attempt_ = 0;    // millis() of the next recovery attempt
+  int attempts_ = 0;
+};
+
+/**
+ * @brief Supervised NMEA 2000 link. Faulty if the controller is bus-off, if
+ * the same frame has been stuck in the transmit buffer for longer than the
+ * timeout, if no message has been sent within the timeout, or if no message
+ * has been received within the receive timeout. The last condition catches
+ * a controller that still transmits but no longer receives.
+ *
+ * This is the only link whose persistent fault can restart the device.
+ */
+class CANLink : public SupervisedLink {
+ public:
+  /**
+   * @param timeout Maximum time without transmissions, in ms
+   * @param rx_timeout Maximum time without received messages, in ms, or 0
+   * to disable the check
+   */
+  CANLink(RecoverableNMEA2000* nmea2000, unsigned long timeout,
+          unsigned long rx_timeout)
+      : SupervisedLink{"NMEA 2000", timeout, true},
+        nmea2000_{nmea2000},
+        rx_timeout_{rx_timeout} {}
+
+  /// Mark a message as received
+  void feed_rx() { last_rx_ = millis(); }
+
+  void reset_activity() override {
+    feed();
+    feed_rx();
+  }
+
+ protected:
+  bool is_faulty() override {
+    if (nmea2000_->is_bus_off()) {
+      return true;
+    }
+    if (rx_timeout_ != 0 && millis() - last_rx_ > rx_timeout_) {
+      return true;
+    }
+    // A single frame takes well under a millisecond to send, so a transmit
+    // buffer that stays locked across checks means the transmitter is
+    // stalled, even though the driver still accepts frames into its queue.
+    if (nmea2000_->is_tx_pending()) {
+      if (!tx_pending_) {
+        tx_pending_ = true;
+        tx_pending_since_ = millis();
+      }
+      if (millis() - tx_pending_since_ > timeout_) {
+        return true;
+      }
+    } else {
+      tx_pending_ = false;
+    }
+    return SupervisedLink::is_faulty();
+  }
+
+  void recover() override {
+    ESP_LOGW("HealthSupervisor",
+             "Recovering CAN controller (bus-off: %d, TEC: %d)",
+             nmea2000_->is_bus_off(), nmea2000_->get_tx_error_count());
+    nmea2000_->recover();
+  }
+
+  RecoverableNMEA2000* nmea2000_;
+  unsigned long rx_timeout_;
+  unsigned long last_rx_ = 0;
+  bool tx_pending_ = false;
+  unsigned long tx_pending_since_ = 0;
+};
+
+/**
+ * @brief Supervised NMEA 0183 input. Faulty if no sentence has been
+ * received within the timeout.
+ *
+ * The NMEA0183IOTask keeps reading the UART from its own task, so the UART
+ * driver must not be torn down under it. Recovery instead discards the
+ * receive buffers and reprograms the baud rate, which resynchronizes the
+ * receiver after framing errors or an overflow. Both calls take the UART
+ * driver lock that the reader also takes.
+ */
+class SerialLink : public SupervisedLink {
+ public:
+  SerialLink(String name, HardwareSerial* serial, unsigned long baud_rate,
+             unsigned long timeout)
+      : SupervisedLink{name, timeout, false},
+        serial_{serial},
+        baud_rate_{baud_rate} {}
+
+ protected:
+  void recover() override {
+    ESP_LOGW("HealthSupervisor", "Resynchronizing serial port for %s",
+             name_.c_str());
+    serial_->flush(false);  // Also discard received data
+    serial_->updateBaudRate(baud_rate_);
+  }
+
+  HardwareSerial* serial_;
+  unsigned long baud_rate_;
+};
+
+/**
+ * @brief Detects link faults within a second or two and recovers them in
+ * place.
+ *
+ * Recovery attempts are retried with an exponential backoff. A full device
+ * restart is only done as a last resort, if enabled and a fault of a link
+ * that allows it (only the NMEA 2000 link) has persisted for kRebootDelay
+ * despite the recovery attempts.
+ */
+class HealthSupervisor {
+ public:
+  HealthSupervisor(bool reboot_enabled) : reboot_enabled_{reboot_enabled} {
+    // Give the links some time to come up before supervising them
+    sensesp::event_loop()->onDelay(kStartupGracePeriod, [this]() {
+      for (auto link : links_) {
+        link->reset_activity();
+      }
+      sensesp::event_loop()->onRepeat(kCheckInterval, [this]() { check(); });
+    });
+  }
+
+  template <typename LinkT>
+  LinkT* add_link(LinkT* link) {
+    links_.push_back(link);
+    return link;
+  }
+
+  /// Time from fault detection to restored operation, in ms
+  sensesp::ObservableValue<int> last_recovery_time_ = 0;
+
+ protected:
+  static constexpr unsigned long kStartupGracePeriod = 5000;
+  static constexpr unsigned long kCheckInterval = 250;
+  static constexpr unsigned long kInitialBackoff = 1000;
+  static constexpr unsigned long kMaxBackoff = 30000;
+  static constexpr unsigned long kRebootDelay = 120000;
+
+  void check() {
+    unsigned long now = millis();
+    for (auto link : links_) {
+      bool faulty = link->is_faulty();
+
+      if (!faulty) {
+        if (link->in_fault_) {
+          // Measure up to the first sign of life rather than to this check
+          unsigned long restored = link->last_activity_ > link->fault_detected_
+                                       ? link->last_activity_
+                                       : now;
+          int recovery_time = restored - link->fault_detected_;
+          ESP_LOGI("HealthSupervisor", "%s recovered in %d ms",
+                   link->name_.c_str(), recovery_time);
+          last_recovery_time_ = recovery_time;
+          link->in_fault_ = false;
+          link->attempts_ = 0;
+        }
+        continue;
+      }
+
+      if (!link->in_fault_) {
+        ESP_LOGW("HealthSupervisor", "%s fault detected",
+                 link->name_.c_str());
+        link->in_fault_ = true;
+        link->fault_detected_ = now;
+        link->next_attempt_ = now;
+      }
+
+      if (reboot_enabled_ && link->reboot_on_fault_ &&
+          now - link->fault_detected_ > kRebootDelay) {
+        ESP_LOGE("HealthSupervisor", "%s did not recover. Restarting.",
+                 link->name_.c_str());
+        // All hope is lost; it doesn't matter if we delay for a bit to
+        // ensure the log message is sent.
+        delay(10);
+        ESP.restart();
+      }
+
+      if ((long)(now - link->next_attempt_) >= 0) {
+        link->recover();
+        unsigned long backoff = kInitialBackoff
+                                << std::min(link->attempts_, 5);
+        link->next_attempt_ = now + std::min(backoff, kMaxBackoff);
+        link->attempts_++;
+        link->recoveries_ = link->recoveries_.get() + 1;
+      }
+    }
+  }
+
+  bool reboot_enabled_;
+  std::vector<SupervisedLink*> links_;
+};
+
+}  // namespace wind_interface
+
+#endif  // AUTONNIC_WIND_SRC_HEALTH_SUPERVISOR_H_
@@ -0,0 +1,254 @@
+#ifndef AUTONNIC_WIND_SRC_IMU_ICM20948_H_
+#define AUTONNIC_WIND_SRC_IMU_ICM20948_H_
+
+#include <Wire.h>
+
+#include <algorithm>
+
+#include "mast_motion.h"
+#include "sensesp.h"
+#include "sensesp/system/observablevalue.h"
+
+namespace wind_interface {
+
+/**
+ * @brief Accelerometer and gyroscope sample in sensor frame.
+ */
+struct ImuSample {
+  float accel[3];  // m/s^2
+  float gyro[3];   // rad/s
+};
+
+/**
+ * @brief Minimal ICM-20948 driver that streams accelerometer and gyroscope
+ * samples through the on-chip FIFO.
+ *
+ * The FIFO is drained in bursts so that a batch of samples costs a couple
+ * of I2C transactions instead of one per sample. Each transaction holds
+ * the Wire bus lock, so the IMU can share the bus with the OLED display.
+ */
+class ICM20948 {
+ public:
+  ICM20948(TwoWire* i2c, uint8_t address = 0x69)
+      : i2c_{i2c}, address_{address} {}
+
+  /**
+   * @brief Reset and configure the device for 112.5 Hz FIFO output.
+   *
+   * @return false if no ICM-20948 responds at the address
+   */
+  bool begin() {
+    write_register(0, kPwrMgmt1, 0x80);  // Device reset
+    delay(10);
+    current_bank_ = 0xFF;
+    write_register(0, kPwrMgmt1, 0x01);  // Wake up, auto-select clock
+    delay(10);
+
+    uint8_t who_am_i = 0;
+    if (!read_registers(0, kWhoAmI, &who_am_i, 1) || who_am_i != 0xEA) {
+      return false;
+    }
+
+    write_register(0, kPwrMgmt2, 0x00);  // Enable accelerometer and gyro
+
+    // Output data rate 1125 Hz / (1 + 9) = 112.5 Hz
+    write_register(2, kOdrAlignEn, 0x01);
+    write_register(2, kGyroSmplrtDiv, 9);
+    write_register(2, kGyroConfig1, 0x0B);  // +-500 dps, DLPF enabled
+    write_register(2, kAccelSmplrtDiv1, 0);
+    write_register(2, kAccelSmplrtDiv2, 9);
+    write_register(2, kAccelConfig, 0x0B);  // +-4 g, DLPF enabled
+
+    write_register(0, kUserCtrl, 0x40);  // FIFO enable
+    write_register(0, kFifoMode, 0x00);  // Stream mode
+    // Accel and gyro XYZ to FIFO. The accelerometer provides the heel.
+    write_register(0, kFifoEn2, 0x1E);
+    reset_fifo();
+    return true;
+  }
+
+  /**
+   * @brief Read all complete samples currently in the FIFO.
+   *
+   * @return Number of samples read, or -1 on a bus error
+   */
+  int read_fifo(ImuSample* samples, int max_samples) {
+    uint8_t count_buf[2];
+    if (!read_registers(0, kFifoCountH, count_buf, 2)) {
+      return -1;
+    }
+    int fifo_count = ((count_buf[0] & 0x1F) << 8) | count_buf[1];
+    if (fifo_count >= kFifoOverflowLevel) {
+      // Samples have been lost and the FIFO may be misaligned; start over
+      ESP_LOGW("ICM20948", "FIFO overflow");
+      reset_fifo();
+      return 0;
+    }
+
+    int num_samples = std::min(fifo_count / kSampleSize, max_samples);
+    int read = 0;
+    while (read < num_samples) {
+      int batch = std::min(num_samples - read, kMaxBurstSamples);
+      uint8_t buf[kMaxBurstSamples * kSampleSize];
+      if (!read_registers(0, kFifoRW, buf, batch * kSampleSize)) {
+        return -1;
+      }
+      for (int i = 0; i < batch; i++) {
+        decode_sample(buf + i * kSampleSize, &samples[read + i]);
+      }
+      read += batch;
+    }
+    return read;
+  }
+
+ protected:
+  // Bank 0
+  static constexpr uint8_t kWhoAmI = 0x00;
+  static constexpr uint8_t kUserCtrl = 0x03;
+  static constexpr uint8_t kPwrMgmt1 = 0x06;
+  static constexpr uint8_t kPwrMgmt2 = 0x07;
+  static constexpr uint8_t kFifoEn2 = 0x67;
+  static constexpr uint8_t kFifoRst = 0x68;
+  static constexpr uint8_t kFifoMode = 0x69;
+  static constexpr uint8_t kFifoCountH = 0x70;
+  static constexpr uint8_t kFifoRW = 0x72;
+  // Bank 2
+  static constexpr uint8_t kGyroSmplrtDiv = 0x00;
+  static constexpr uint8_t kGyroConfig1 = 0x01;
+  static constexpr uint8_t kOdrAlignEn = 0x09;
+  static constexpr uint8_t kAccelSmplrtDiv1 = 0x10;
+  static constexpr uint8_t kAccelSmplrtDiv2 = 0x11;
+  static constexpr uint8_t kAccelConfig = 0x14;
+  // All banks
+  static constexpr uint8_t kRegBankSel = 0x7F;
+
+  // Accel XYZ followed by gyro XYZ, 16 bits each
+  static constexpr int kSampleSize = 12;
+  // Stay below the 128 byte Wire buffer
+  static constexpr int kMaxBurstSamples = 10;
+  static constexpr int kFifoOverflowLevel = 512 - kSampleSize;
+
+  static constexpr float kAccelScale = 9.80665f / 8192;  // +-4 g
+  static constexpr float kGyroScale = M_PI / 180 / 65.5;  // +-500 dps
+
+  void reset_fifo() {
+    write_register(0, kFifoRst, 0x1F);
+    write_register(0, kFifoRst, 0x00);
+  }
+
+  static void decode_sample(const uint8_t* buf, ImuSample* sample) {
+    for (int i = 0; i < 3; i++) {
+      int16_t accel = (buf[2 * i] << 8) | buf[2 * i + 1];
+      int16_t gyro = (buf[6 + 2 * i] << 8) | buf[6 + 2 * i + 1];
+      sample->accel[i] = accel * kAccelScale;
+      sample->gyro[i] = gyro * kGyroScale;
+    }
+  }
+
+  bool select_bank(uint8_t bank) {
+    if (bank == current_bank_) {
+      return true;
+    }
+    i2c_->beginTransmission(address_);
+    i2c_->write(kRegBankSel);
+    i2c_->write(bank << 4);
+    if (i2c_->endTransmission() != 0) {
+      current_bank_ = 0xFF;
+      return false;
+    }
+    current_bank_ = bank;
+    return true;
+  }
+
+  bool write_register(uint8_t bank, uint8_t reg, uint8_t value) {
+    if (!select_bank(bank)) {
+      return false;
+    }
+    i2c_->beginTransmission(address_);
+    i2c_->write(reg);
+    i2c_->write(value);
+    return i2c_->endTransmission() == 0;
+  }
+
+  bool read_registers(uint8_t bank, uint8_t reg, uint8_t* buf, size_t len) {
+    if (!select_bank(bank)) {
+      return false;
+    }
+    i2c_->beginTransmission(address_);
+    i2c_->write(reg);
+    if (i2c_->endTransmission(false) != 0) {
+      return false;
+    }
+    if (i2c_->requestFrom((uint16_t)address_, len, true) != len) {
+      return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+      buf[i] = i2c_->read();
+    }
+    return true;
+  }
+
+  TwoWire* i2c_;
+  uint8_t address_;
+  uint8_t current_bank_ = 0xFF;
+};
+
+/**
+ * @brief FreeRTOS task that drains the ICM-20948 FIFO in batches and feeds
+ * the rotation rates and accelerations to a MotionAccumulator.
+ *
+ * The chip is assumed to be mounted flat, component side up, with its
+ * X axis pointing forward. The sensor frame is then rotated 180 degrees
+ * about X relative to the boat frame (x forward, y starboard, z down).
+ */
+class ImuReader {
+ public:
+  ImuReader(ICM20948* imu, MotionAccumulator* motion)
+      : imu_{imu}, motion_{motion} {}
+
+  void start() {
+    xTaskCreatePinnedToCore(task_entry, "imu", 4096, this, 2, nullptr, 0);
+    // Publish the effective sample rate once per second
+    sensesp::event_loop()->onRepeat(1000, [this]() {
+      uint32_t count = sample_count_;
+      sample_rate_ = count - last_sample_count_;
+      last_sample_count_ = count;
+    });
+  }
+
+  /// Samples received during the last second
+  sensesp::ObservableValue<int> sample_rate_ = 0;
+
+ protected:
+  // FIFO drain interval, in ms. About 5 samples per batch at 112.5 Hz.
+  static constexpr int kBatchInterval = 40;
+  static constexpr int kMaxSamples = 16;
+
+  static void task_entry(void* arg) { static_cast<ImuReader*>(arg)->run(); }
+
+  void run() {
+    TickType_t last_wake = xTaskGetTickCount();
+    while (true) {
+      vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(kBatchInterval));
+      int num_samples = imu_->read_fifo(samples_, kMaxSamples);
+      for (int i = 0; i < num_samples; i++) {
+        const ImuSample& sample = samples_[i];
+        motion_->add_sample(sample.gyro[0], -sample.gyro[1], -sample.accel[1],
+                            -sample.accel[2]);
+      }
+      if (num_samples > 0) {
+        sample_count_ += num_samples;
+      }
+    }
+  }
+
+  ICM20948* imu_;
+  MotionAccumulator* motion_;
+  ImuSample samples_[kMaxSamples];
+  volatile uint32_t sample_count_ = 0;
+  uint32_t last_sample_count_ = 0;
+};
+
+}  // namespace wind_interface
+
+#endif  // AUTONNIC_WIND_SRC_IMU_ICM20948_H_
@@ -0,0 +1,157 @@
+#ifndef AUTONNIC_WIND_SRC_IMU_MAST_MOTION_H_
+#define AUTONNIC_WIND_SRC_IMU_MAST_MOTION_H_
+
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+
+namespace wind_interface {
+
+/**
+ * @brief Velocity of the masthead caused by boat rotation, in m/s.
+ *
+ * Boat frame: x forward, y starboard, z down.
+ */
+struct MastVelocity {
+  float forward;
+  float starboard;
+};
+
+/**
+ * @brief Thread-safe accumulator of boat rotation rates and heel.
+ *
+ * The IMU task adds samples at the IMU output data rate. Consumers take
+ * snapshots of the running sums and average the rates over the interval
+ * between two snapshots, so any number of consumers can read the same
+ * accumulator at their own pace.
+ *
+ * A slow running mean of each rate is subtracted as gyro bias estimate;
+ * over minutes, a boat does not keep rolling or pitching in one direction.
+ *
+ * The heel is derived from the gravity direction in the y-z plane. The
+ * accelerometer components are low-pass filtered first, which averages
+ * out the wave induced rolling and the accelerations of the masthead.
+ */
+class MotionAccumulator {
+ public:
+  struct Snapshot {
+    double roll_rate_sum = 0;   // rad/s
+    double pitch_rate_sum = 0;  // rad/s
+    uint32_t count = 0;
+  };
+
+  /**
+   * @param bias_time_constant Gyro bias time constant, in samples
+   * @param heel_time_constant Heel filter time constant, in samples
+   */
+  MotionAccumulator(float bias_time_constant = 6000,
+                    float heel_time_constant = 1000)
+      : bias_gain_{1.0f / bias_time_constant},
+        heel_gain_{1.0f / heel_time_constant} {}
+
+  /**
+   * @brief Add an IMU sample in boat frame.
+   *
+   * @param roll_rate Rate about the x axis (starboard down), rad/s
+   * @param pitch_rate Rate about the y axis (bow up), rad/s
+   * @param accel_y Accelerometer reading along the y axis, m/s^2
+   * @param accel_z Accelerometer reading along the z axis, m/s^2; about
+   * -9.8 when upright, since the accelerometer measures the reaction to
+   * gravity
+   */
+  void add_sample(float roll_rate, float pitch_rate, float accel_y,
+                  float accel_z) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    roll_bias_ += bias_gain_ * (roll_rate - roll_bias_);
+    pitch_bias_ += bias_gain_ * (pitch_rate - pitch_bias_);
+    sums_.roll_rate_sum += roll_rate - roll_bias_;
+    sums_.pitch_rate_sum += pitch_rate - pitch_bias_;
+    if (sums_.count == 0) {
+      accel_y_ = accel_y;
+      accel_z_ = accel_z;
+    } else {
+      accel_y_ += heel_gain_ * (accel_y - accel_y_);
+      accel_z_ += heel_gain_ * (accel_z - accel_z_);
+    }
+    sums_.count++;
+  }
+
+  Snapshot snapshot() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sums_;
+  }
+
+  /// Heel angle, rad, positive to starboard. 0 before the first sample.
+  float heel() {
+    float accel_y, accel_z;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      accel_y = accel_y_;
+      accel_z = accel_z_;
+    }
+    return atan2f(-accel_y, -accel_z);
+  }
+
+ protected:
+  std::mutex mutex_;
+  float bias_gain_;
+  float heel_gain_;
+  float roll_bias_ = 0;
+  float pitch_bias_ = 0;
+  // Filtered accelerometer readings
+  float accel_y_ = 0;
+  float accel_z_ = -1;
+  Snapshot sums_;
+};
+
+/**
+ * @brief Mean masthead velocity between two accumulator snapshots.
+ *
+ * @param mast_height Height of the sensor above the center of rotation, m
+ * @param[out] velocity Mean masthead velocity
+ * @return false if no IMU samples were accumulated in the interval
+ */
+inline bool MeanMastVelocity(const MotionAccumulator::Snapshot& previous,
+                             const MotionAccumulator::Snapshot& current,
+                             float mast_height, MastVelocity* velocity) {
+  uint32_t count = current.count - previous.count;
+  if (count == 0) {
+    return false;
+  }
+  float roll_rate = (current.roll_rate_sum - previous.roll_rate_sum) / count;
+  float pitch_rate =
+      (current.pitch_rate_sum - previous.pitch_rate_sum) / count;
+  // v = omega x r, with r = (0, 0, -h) pointing up the mast
+  velocity->forward = -mast_height * pitch_rate;
+  velocity->starboard = mast_height * roll_rate;
+  return true;
+}
+
+/**
+ * @brief Remove the masthead motion from an apparent wind measurement.
+ *
+ * A sensor moving through still air measures a wind blowing from the
+ * direction of motion, so the masthead velocity is subtracted from the
+ * "wind from" vector.
+ *
+ * @param speed Measured wind speed, m/s
+ * @param angle Measured wind angle, rad, clockwise from the bow
+ * @param[out] out_speed Compensated wind speed, m/s
+ * @param[out] out_angle Compensated wind angle, rad, 0 to 2*pi
+ */
+inline void CompensateMastMotion(float speed, float angle,
+                                 const MastVelocity& velocity,
+                                 float* out_speed, float* out_angle) {
+  float forward = speed * cosf(angle) - velocity.forward;
+  float starboard = speed * sinf(angle) - velocity.starboard;
+  *out_speed = sqrtf(forward * forward + starboard * starboard);
+  float out = atan2f(starboard, forward);
+  if (out < 0) {
+    out += 2 * M_PI;
+  }
+  *out_angle = out;
+}
+
+}  // namespace wind_interface
+
+#endif  // AUTONNIC_WIND_SRC_IMU_MAST_MOTION_H_
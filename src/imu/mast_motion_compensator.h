@@ -0,0 +1,97 @@
+#ifndef AUTONNIC_WIND_SRC_IMU_MAST_MOTION_COMPENSATOR_H_
+#define AUTONNIC_WIND_SRC_IMU_MAST_MOTION_COMPENSATOR_H_
+
+#include "mast_motion.h"
+#include "sensesp.h"
+#include "sensesp/system/lambda_consumer.h"
+#include "sensesp/system/saveable.h"
+#include "sensesp/system/serializable.h"
+#include "sensesp_nmea0183/data/wind_data.h"
+#include "wind_sample.h"
+
+namespace wind_interface {
+
+/**
+ * @brief Removes mast-induced velocity from apparent wind data.
+ *
+ * Each wind sample is compensated with the mean masthead
+ * velocity since the previous wind sample. The A5120 output is itself
+ * damped, so averaging over the sample interval matches it better than
+ * the instantaneous velocity would. If compensation is disabled or no IMU
+ * samples are available, the input is passed through unchanged.
+ */
+class MastMotionCompensator : public sensesp::FileSystemSaveable,
+                              virtual public sensesp::Serializable {
+ public:
+  MastMotionCompensator(MotionAccumulator* motion, float mast_height,
+                        bool enabled, String config_path = "")
+      : sensesp::FileSystemSaveable(config_path),
+        sensesp::Serializable(),
+        motion_{motion},
+        mast_height_{mast_height},
+        enabled_{enabled} {
+    load();
+    previous_ = motion_->snapshot();
+  }
+
+  sensesp::LambdaConsumer<WindSample> wind_input_{
+      [this](const WindSample& sample) { update(sample); }};
+
+  /// Compensated apparent wind
+  sensesp::nmea0183::ApparentWindData wind_data_;
+
+  inline virtual bool to_json(JsonObject& doc) override {
+    doc["enabled"] = enabled_;
+    doc["mast_height"] = mast_height_;
+    return true;
+  }
+
+  inline virtual bool from_json(const JsonObject& config) override {
+    String expected_keys[] = {"enabled", "mast_height"};
+    for (auto& key : expected_keys) {
+      if (!config[key].is<JsonVariant>()) {
+        return false;
+      }
+    }
+    enabled_ = config["enabled"];
+    mast_height_ = config["mast_height"];
+    return true;
+  }
+
+ protected:
+  void update(const WindSample& sample) {
+    MotionAccumulator::Snapshot current = motion_->snapshot();
+    MastVelocity velocity;
+    float speed = sample.speed;
+    float angle = sample.angle;
+    if (MeanMastVelocity(previous_, current, mast_height_, &velocity) &&
+        enabled_) {
+      CompensateMastMotion(sample.speed, sample.angle, velocity, &speed,
+                           &angle);
+    }
+    previous_ = current;
+
+    wind_data_.angle.set(angle);
+    wind_data_.speed.set(speed);
+  }
+
+  MotionAccumulator* motion_;
+  MotionAccumulator::Snapshot previous_;
+  float mast_height_;  // Sensor height above the center of rotation, m
+  bool enabled_;
+};
+
+inline const String ConfigSchema(const MastMotionCompensator& obj) {
+  const char schema[] = R"({
+      "type": "object",
+      "properties": {
+        "enabled": { "title": "Enabled", "type": "boolean" },
+        "mast_height": { "title": "Mast Height (m)", "type": "number" }
+      }
+    })";
+  return schema;
+}
+
+}  // namespace wind_interface
+
+#endif  // AUTONNIC_WIND_SRC_IMU_MAST_MOTION_COMPENSATOR_H_
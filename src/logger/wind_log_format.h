@@ -0,0 +1,286 @@
+#ifndef AUTONNIC_WIND_SRC_LOGGER_WIND_LOG_FORMAT_H_
+#define AUTONNIC_WIND_SRC_LOGGER_WIND_LOG_FORMAT_H_
+
+// Wind log sector format.
+//
+// The log is a ring of 4096 byte flash sectors. Each sector starts with a
+// 20 byte header followed by a stream of records:
+//
+//   Header (little-endian)
+//     uint32 magic        kMagic
+//     uint32 sequence     Incremented for every sector written
+//     uint32 epoch        Unix time at base_ms, or 0 if unknown
+//     uint32 base_ms      Device uptime the record times are relative to
+//     uint16 payload_len  Number of record bytes
+//     uint16 reserved     0xFFFF
+//
+//   Delta record (1 byte)
+//     High nibble: speed change, signed, 0.1 m/s units, -7..7
+//     Low nibble: angle change, signed, 1 degree units, -8..7
+//     The sample time is the previous sample time plus the current period.
+//     Used while the actual time is within a quarter period of that, so
+//     decoded times are accurate to a quarter period.
+//
+//   Keyframe (11 bytes), used when a delta does not fit
+//     uint8  0x80
+//     uint32 time_ms      Relative to base_ms
+//     uint16 period_ms    Expected interval to the next sample
+//     uint16 speed        0.1 m/s units
+//     uint16 angle        1 degree units, 0..359
+//
+// Every sector begins with a keyframe and can be decoded on its own. The
+// header is written after the payload, so a sector torn by a power loss
+// has an erased header and is skipped.
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace wind_interface {
+
+class WindLogFormat {
+ public:
+  static constexpr size_t kSectorSize = 4096;
+  static constexpr size_t kHeaderSize = 20;
+  static constexpr size_t kPayloadSize = kSectorSize - kHeaderSize;
+  static constexpr uint32_t kMagic = 0x31474C57;  // "WLG1"
+  static constexpr uint8_t kKeyframeMarker = 0x80;
+  static constexpr size_t kKeyframeSize = 11;
+
+  struct Header {
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t epoch;
+    uint32_t base_ms;
+    uint16_t payload_len;
+  };
+
+  struct Sample {
+    uint32_t time_ms;  // Relative to Header::base_ms
+    float speed;       // m/s
+    float angle;       // rad, 0 to 2*pi
+  };
+
+  static void write_header(uint8_t* sector, const Header& header) {
+    put32(sector, header.magic);
+    put32(sector + 4, header.sequence);
+    put32(sector + 8, header.epoch);
+    put32(sector + 12, header.base_ms);
+    put16(sector + 16, header.payload_len);
+    put16(sector + 18, 0xFFFF);
+  }
+
+  /// @return false if the sector does not hold a valid header
+  static bool read_header(const uint8_t* sector, Header* header) {
+    header->magic = get32(sector);
+    header->sequence = get32(sector + 4);
+    header->epoch = get32(sector + 8);
+    header->base_ms = get32(sector + 12);
+    header->payload_len = get16(sector + 16);
+    return header->magic == kMagic && header->payload_len <= kPayloadSize;
+  }
+
+  static void put16(uint8_t* buf, uint16_t value) {
+    buf[0] = value & 0xFF;
+    buf[1] = value >> 8;
+  }
+  static void put32(uint8_t* buf, uint32_t value) {
+    put16(buf, value & 0xFFFF);
+    put16(buf + 2, value >> 16);
+  }
+  static uint16_t get16(const uint8_t* buf) { return buf[0] | (buf[1] << 8); }
+  static uint32_t get32(const uint8_t* buf) {
+    return get16(buf) | ((uint32_t)get16(buf + 2) << 16);
+  }
+
+  static int quantize_speed(float speed) { return lroundf(speed * 10); }
+  static int quantize_angle(float angle) {
+    int degrees = lroundf(angle * 180 / M_PI) % 360;
+    return degrees < 0 ? degrees + 360 : degrees;
+  }
+};
+
+/**
+ * @brief Encodes wind samples into a single log sector buffer.
+ */
+class WindLogEncoder {
+ public:
+  /// Start a new sector in buf, which must hold WindLogFormat::kSectorSize
+  void begin(uint8_t* buf, uint32_t sequence, uint32_t epoch,
+             uint32_t base_ms) {
+    buf_ = buf;
+    memset(buf_, 0xFF, WindLogFormat::kSectorSize);
+    header_ = {WindLogFormat::kMagic, sequence, epoch, base_ms, 0};
+    has_keyframe_ = false;
+  }
+
+  /**
+   * @brief Append a sample.
+   *
+   * @param time_ms Device uptime of the sample
+   * @return false if the sector is full; the sample was not added
+   */
+  bool add(uint32_t time_ms, float speed, float angle) {
+    uint32_t rel_time = time_ms - header_.base_ms;
+    int speed_q = WindLogFormat::quantize_speed(speed);
+    int angle_q = WindLogFormat::quantize_angle(angle);
+
+    if (has_keyframe_) {
+      int d_speed = speed_q - speed_q_;
+      int d_angle = angle_q - angle_q_;
+      // Take the short way around the circle
+      if (d_angle > 180) d_angle -= 360;
+      if (d_angle < -180) d_angle += 360;
+      uint32_t expected = time_ + period_;
+      uint32_t jitter =
+          rel_time > expected ? rel_time - expected : expected - rel_time;
+
+      if (d_speed >= -7 && d_speed <= 7 && d_angle >= -8 && d_angle <= 7 &&
+          jitter <= period_ / 4) {
+        if (header_.payload_len >= WindLogFormat::kPayloadSize) {
+          return false;
+        }
+        payload()[header_.payload_len++] =
+            ((d_speed & 0x0F) << 4) | (d_angle & 0x0F);
+        speed_q_ = speed_q;
+        angle_q_ = (angle_q_ + d_angle + 360) % 360;
+        time_ = expected;
+        last_time_ms_ = time_ms;
+        segment_samples_++;
+        return true;
+      }
+    }
+
+    // Keyframe
+    if (header_.payload_len + WindLogFormat::kKeyframeSize >
+        WindLogFormat::kPayloadSize) {
+      return false;
+    }
+    update_period(time_ms);
+    uint8_t* rec = payload() + header_.payload_len;
+    rec[0] = WindLogFormat::kKeyframeMarker;
+    WindLogFormat::put32(rec + 1, rel_time);
+    WindLogFormat::put16(rec + 5, period_);
+    WindLogFormat::put16(rec + 7, speed_q < 0 ? 0 : speed_q);
+    WindLogFormat::put16(rec + 9, angle_q);
+    header_.payload_len += WindLogFormat::kKeyframeSize;
+    time_ = rel_time;
+    speed_q_ = speed_q < 0 ? 0 : speed_q;
+    angle_q_ = angle_q;
+    has_keyframe_ = true;
+    return true;
+  }
+
+  bool empty() const { return header_.payload_len == 0; }
+
+  /// Write the header. Call once the sector is complete.
+  void finish() { WindLogFormat::write_header(buf_, header_); }
+
+  /// Copy the incomplete sector, with a valid header, to dest.
+  void copy_to(uint8_t* dest) const {
+    memcpy(dest, buf_, WindLogFormat::kSectorSize);
+    WindLogFormat::write_header(dest, header_);
+  }
+
+ protected:
+  uint8_t* payload() { return buf_ + WindLogFormat::kHeaderSize; }
+
+  /**
+   * @brief Re-estimate the period at a keyframe from the actual sample
+   * times.
+   *
+   * An interval far from the period is an output rate change and is taken
+   * as is. Otherwise the period has drifted from the real one, and the
+   * mean interval since the previous keyframe is used, which averages out
+   * the timing jitter.
+   */
+  void update_period(uint32_t time_ms) {
+    if (has_last_time_) {
+      uint32_t interval = time_ms - last_time_ms_;
+      uint32_t period = interval;
+      if (interval >= period_ / 2u && interval <= period_ * 3u / 2) {
+        uint32_t intervals = segment_samples_ + 1;
+        period = (time_ms - segment_start_ms_ + intervals / 2) / intervals;
+      }
+      period_ = period < 1 ? 1 : (period > 0xFFFF ? 0xFFFF : period);
+    }
+    last_time_ms_ = time_ms;
+    has_last_time_ = true;
+    segment_start_ms_ = time_ms;
+    segment_samples_ = 0;
+  }
+
+  uint8_t* buf_ = nullptr;
+  WindLogFormat::Header header_ = {};
+  bool has_keyframe_ = false;
+  uint32_t time_ = 0;  // Sample time as seen by the decoder
+  // Expected sample interval, in ms. Carried over to the next sector.
+  uint16_t period_ = 100;
+  // Actual uptime of the previous sample and of the last keyframe, and the
+  // number of samples since that keyframe
+  bool has_last_time_ = false;
+  uint32_t last_time_ms_ = 0;
+  uint32_t segment_start_ms_ = 0;
+  uint32_t segment_samples_ = 0;
+  int speed_q_ = 0;
+  int angle_q_ = 0;
+};
+
+/**
+ * @brief Decodes the samples of a single log sector.
+ */
+class WindLogDecoder {
+ public:
+  /// @return false if the sector is not valid
+  bool begin(const uint8_t* sector) {
+    sector_ = sector;
+    pos_ = 0;
+    return WindLogFormat::read_header(sector, &header_);
+  }
+
+  const WindLogFormat::Header& header() const { return header_; }
+
+  /// @return false when there are no more samples
+  bool next(WindLogFormat::Sample* sample) {
+    const uint8_t* payload = sector_ + WindLogFormat::kHeaderSize;
+    if (pos_ >= header_.payload_len) {
+      return false;
+    }
+    uint8_t b = payload[pos_];
+    if (b == WindLogFormat::kKeyframeMarker) {
+      if (pos_ + WindLogFormat::kKeyframeSize > header_.payload_len) {
+        return false;
+      }
+      time_ = WindLogFormat::get32(payload + pos_ + 1);
+      period_ = WindLogFormat::get16(payload + pos_ + 5);
+      speed_q_ = WindLogFormat::get16(payload + pos_ + 7);
+      angle_q_ = WindLogFormat::get16(payload + pos_ + 9);
+      pos_ += WindLogFormat::kKeyframeSize;
+    } else {
+      int d_speed = (int8_t)(b & 0xF0) >> 4;
+      int d_angle = (int8_t)(b << 4) >> 4;
+      time_ += period_;
+      speed_q_ += d_speed;
+      angle_q_ = (angle_q_ + d_angle + 360) % 360;
+      pos_++;
+    }
+    sample->time_ms = time_;
+    sample->speed = speed_q_ / 10.0f;
+    sample->angle = angle_q_ * M_PI / 180;
+    return true;
+  }
+
+ protected:
+  const uint8_t* sector_ = nullptr;
+  WindLogFormat::Header header_ = {};
+  size_t pos_ = 0;
+  uint32_t time_ = 0;
+  uint16_t period_ = 0;
+  int speed_q_ = 0;
+  int angle_q_ = 0;
+};
+
+}  // namespace wind_interface
+
+#endif  // AUTONNIC_WIND_SRC_LOGGER_WIND_LOG_FORMAT_H_
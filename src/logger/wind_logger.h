@@ -0,0 +1,232 @@
+#ifndef AUTONNIC_WIND_SRC_LOGGER_WIND_LOGGER_H_
+#define AUTONNIC_WIND_SRC_LOGGER_WIND_LOGGER_H_
+
+#include <esp_http_server.h>
+#include <esp_partition.h>
+#include <time.h>
+
+#include <memory>
+#include <mutex>
+
+#include "sensesp.h"
+#include "sensesp/net/http_server.h"
+#include "sensesp/system/lambda_consumer.h"
+#include "sensesp/system/observablevalue.h"
+#include "wind_log_format.h"
+#include "wind_sample.h"
+
+namespace wind_interface {
+
+/**
+ * @brief Logs apparent wind samples into a ring of flash sectors.
+ *
+ * Samples are delta-encoded into a RAM sector buffer on the event loop.
+ * Full sectors are handed to a writer task, so the event loop never waits
+ * for the writer. If the writer falls behind, the sector is dropped rather
+ * than waiting for it.
+ *
+ * Known cost: while a sector is erased or written, the flash cache is
+ * disabled on both cores, and any code that runs from flash stalls. That
+ * includes the event loop. A 4 KiB sector erase typically takes about 45 ms,
+ * and up to a few hundred ms worst case per the flash datasheets. A sector
+ * holds about 4000 samples, so at the 10 Hz sensor rate this happens about
+ * every 7 minutes (every 8.5 minutes at 8 Hz). Each time, one or two
+ * 100 ms PGN 130306 transmissions are delayed.
+ *
+ * The log is served as a streaming binary download, oldest sector first,
+ * followed by the sector currently being filled. See wind_log_format.h
+ * for the format.
+ */
+class WindLogger {
+ public:
+  WindLogger(const char* partition_label = "windlog") {
+    partition_ = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partition_label);
+    if (partition_ == nullptr) {
+      ESP_LOGE("WindLogger", "Partition '%s' not found", partition_label);
+      status_ = String("Partition '") + partition_label +
+                "' not found. Flash the firmware over serial to update the "
+                "partition table.";
+      return;
+    }
+    num_sectors_ = partition_->size / WindLogFormat::kSectorSize;
+    find_write_position();
+
+    write_queue_ = xQueueCreate(2, sizeof(int));
+    xTaskCreatePinnedToCore(task_entry, "windlog", 3072, this, 1, nullptr, 0);
+    sensesp::event_loop()->onRepeat(1000, [this]() {
+      if (sectors_written_.get() != sectors_written_count_) {
+        sectors_written_ = sectors_written_count_;
+      }
+    });
+
+    encoder_.begin(buffers_[active_], next_sequence_++, current_epoch(),
+                   millis());
+  }
+
+  sensesp::LambdaConsumer<WindSample> wind_input_{
+      [this](const WindSample& sample) { add_sample(sample); }};
+
+  /// Register the download handler at the given URI
+  void add_http_handler(sensesp::HTTPServer* server,
+                        const char* uri = "/api/windlog") {
+    auto handler = std::make_shared<sensesp::HTTPRequestHandler>(
+        1 << HTTP_GET, uri,
+        [this](httpd_req_t* req) { return handle_download(req); });
+    server->add_handler(handler);
+  }
+
+  /// Human readable logger state
+  sensesp::ObservableValue<String> status_ = "OK";
+  sensesp::ObservableValue<int> samples_logged_ = 0;
+  sensesp::ObservableValue<int> sectors_written_ = 0;
+  sensesp::ObservableValue<int> sectors_dropped_ = 0;
+
+ protected:
+  static void task_entry(void* arg) { static_cast<WindLogger*>(arg)->run(); }
+
+  static uint32_t current_epoch() {
+    time_t now = time(nullptr);
+    // Before the clock has been set, time() counts from 1970
+    return now > 1600000000 ? now : 0;
+  }
+
+  /// Continue after the sector with the highest sequence number
+  void find_write_position() {
+    uint8_t header_buf[WindLogFormat::kHeaderSize];
+    WindLogFormat::Header header;
+    bool found = false;
+    uint32_t max_sequence = 0;
+    for (int i = 0; i < num_sectors_; i++) {
+      esp_partition_read(partition_, i * WindLogFormat::kSectorSize,
+                         header_buf, sizeof(header_buf));
+      if (WindLogFormat::read_header(header_buf, &header) &&
+          (!found || (int32_t)(header.sequence - max_sequence) > 0)) {
+        found = true;
+        max_sequence = header.sequence;
+        next_sector_ = (i + 1) % num_sectors_;
+      }
+    }
+    next_sequence_ = found ? max_sequence + 1 : 0;
+  }
+
+  void add_sample(const WindSample& sample) {
+    if (partition_ == nullptr) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(active_mutex_);
+    uint32_t now = millis();
+    if (!encoder_.add(now, sample.speed, sample.angle)) {
+      flush_active();
+      encoder_.begin(buffers_[active_], next_sequence_++, current_epoch(),
+                     now);
+      encoder_.add(now, sample.speed, sample.angle);
+    }
+    samples_logged_ = samples_logged_.get() + 1;
+  }
+
+  /// Hand the active buffer to the writer task and switch buffers.
+  void flush_active() {
+    encoder_.finish();
+    int other = 1 - active_;
+    if (pending_[other]) {
+      // The writer is still busy with the other buffer; reuse this one
+      sectors_dropped_ = sectors_dropped_.get() + 1;
+      return;
+    }
+    pending_[active_] = true;
+    xQueueSend(write_queue_, &active_, 0);
+    active_ = other;
+  }
+
+  void run() {
+    int index;
+    while (true) {
+      if (xQueueReceive(write_queue_, &index, portMAX_DELAY) != pdTRUE) {
+        continue;
+      }
+      const uint8_t* buf = buffers_[index];
+      size_t offset = next_sector_ * WindLogFormat::kSectorSize;
+      // Write the header last so that a torn sector is not valid
+      esp_err_t err = esp_partition_erase_range(partition_, offset,
+                                                WindLogFormat::kSectorSize);
+      if (err == ESP_OK) {
+        err = esp_partition_write(partition_,
+                                  offset + WindLogFormat::kHeaderSize,
+                                  buf + WindLogFormat::kHeaderSize,
+                                  WindLogFormat::kPayloadSize);
+      }
+      if (err == ESP_OK) {
+        err = esp_partition_write(partition_, offset, buf,
+                                  WindLogFormat::kHeaderSize);
+      }
+      if (err != ESP_OK) {
+        ESP_LOGE("WindLogger", "Writing sector %d failed: %s", next_sector_,
+                 esp_err_to_name(err));
+      }
+      next_sector_ = (next_sector_ + 1) % num_sectors_;
+      sectors_written_count_++;
+      pending_[index] = false;
+    }
+  }
+
+  esp_err_t handle_download(httpd_req_t* req) {
+    if (partition_ == nullptr) {
+      httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No log partition");
+      return ESP_FAIL;
+    }
+    std::lock_guard<std::mutex> download_lock(download_mutex_);
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Content-Disposition",
+                       "attachment; filename=\"windlog.bin\"");
+
+    // The sector to be overwritten next is the oldest one
+    int first = next_sector_;
+    WindLogFormat::Header header;
+    for (int i = 0; i < num_sectors_; i++) {
+      size_t offset =
+          ((first + i) % num_sectors_) * WindLogFormat::kSectorSize;
+      esp_partition_read(partition_, offset, download_buffer_,
+                         WindLogFormat::kSectorSize);
+      if (!WindLogFormat::read_header(download_buffer_, &header)) {
+        continue;
+      }
+      if (httpd_resp_send_chunk(req, (const char*)download_buffer_,
+                                WindLogFormat::kSectorSize) != ESP_OK) {
+        return ESP_FAIL;
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(active_mutex_);
+      encoder_.copy_to(download_buffer_);
+    }
+    if (httpd_resp_send_chunk(req, (const char*)download_buffer_,
+                              WindLogFormat::kSectorSize) != ESP_OK) {
+      return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, nullptr, 0);
+  }
+
+  const esp_partition_t* partition_ = nullptr;
+  int num_sectors_ = 0;
+  volatile int next_sector_ = 0;  // Owned by the writer task after setup
+  uint32_t next_sequence_ = 0;
+
+  WindLogEncoder encoder_;
+  uint8_t buffers_[2][WindLogFormat::kSectorSize];
+  int active_ = 0;
+  // Set while a buffer is queued for or being written to flash
+  volatile bool pending_[2] = {false, false};
+  std::mutex active_mutex_;
+  QueueHandle_t write_queue_ = nullptr;
+  volatile int sectors_written_count_ = 0;
+
+  uint8_t download_buffer_[WindLogFormat::kSectorSize];
+  std::mutex download_mutex_;
+};
+
+}  // namespace wind_interface
+
+#endif  // AUTONNIC_WIND_SRC_LOGGER_WIND_LOGGER_H_
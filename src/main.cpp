@@ -10,11 +10,17 @@
 
 #include <NMEA2000_esp32.h>
 
+#include <vector>
+
 #include "Wire.h"
-#include "autonnic_a5120_parser.h"
-#include "autonnic_config.h"
-#include "elapsedMillis.h"
+#include "health_supervisor.h"
+#include "imu/icm20948.h"
+#include "logger/wind_logger.h"
+#include "net/nmea0183_mux_service.h"
+#include "net/wind_stream.h"
+#include "output/nmea0183_wind_output.h"
 #include "sender/n2k_senders.h"
+#include "sensesp/signalk/signalk_ws_client.h"
 #include "sensesp/system/serial_number.h"
 #include "sensesp/system/stream_producer.h"
 #include "sensesp/transforms/filter.h"
@@ -28,6 +34,7 @@
 #include "sensesp_nmea0183/sentence_parser/wind_sentence_parser.h"
 #include "sensesp_nmea0183/wiring.h"
 #include "ssd1306_display.h"
+#include "wind_instrument.h"
 
 using namespace sensesp;
 using namespace sensesp::nmea0183;
@@ -37,6 +44,15 @@ constexpr int kWindBitRate = 4800;
 constexpr int kWindRxPin = 19;
 // set the Tx pin to -1 if you don't want to use it
 constexpr int kWindTxPin = 18;
+// Second RS485 interface, used by the optional bow wind sensor
+// EDIT: Change the pins below to match your wiring.
+constexpr int kWind2RxPin = 25;
+constexpr int kWind2TxPin = 27;
+
+// I2C address of the ICM-20948 IMU (0x68 if AD0 is pulled low)
+constexpr uint8_t kImuAddress = 0x69;
+// Default wind sensor height above the waterline, in meters
+constexpr float kMastHeight = 15.0;
 
 // CAN bus pins for SH-ESP32
 constexpr gpio_num_t kCANRxPin = GPIO_NUM_34;
@@ -45,8 +61,29 @@ constexpr gpio_num_t kCANTxPin = GPIO_NUM_32;
 ObservableValue<int> n2k_rx_counter = 0;
 ObservableValue<int> n2k_tx_counter = 0;
 
-elapsedMillis n2k_time_since_rx = 0;
-elapsedMillis n2k_time_since_tx = 0;
+// Maximum time without NMEA 2000 transmissions before the link is
+// considered faulty, in ms
+constexpr unsigned long kN2kTxTimeout = 1000;
+// Maximum time without received NMEA 2000 messages before the link is
+// considered faulty, in ms. On a quiet bus, the only traffic may be the
+// 60 s heartbeats (PGN 126993) of the other devices.
+constexpr unsigned long kN2kRxTimeout = 150000;
+
+// Default port for raw NMEA 0183 over TCP and UDP
+constexpr uint16_t kNMEA0183MuxPort = 10110;
+
+// Shortest useful wind sensor output intervals of the outputs, in ms.
+// Network clients and the live stream get every sample the sensor sends.
+// NMEA 2000 displays and autopilots damp the wind over a second or more,
+// and Signal K clients typically update a few times per second. The
+// NMEA 0183 output requests its configured sentence interval.
+constexpr unsigned int kN2kDemandInterval = 250;
+constexpr unsigned int kSKDemandInterval = 500;
+constexpr unsigned int kNMEA0183MuxDemandInterval = 125;
+constexpr unsigned int kWindStreamDemandInterval = 125;
+// The NMEA 2000 output is considered in use while other devices have sent
+// messages within this time, in ms
+constexpr unsigned long kN2kActivityTimeout = 5000;
 
 // The setup function performs one-time application initialization.
 void setup() {
@@ -91,103 +128,87 @@ void setup() {
                     ->enable_ota("thisisfine")
                     ->get_app();
 
-  Serial1.begin(kWindBitRate, SERIAL_8N1, kWindRxPin, kWindTxPin);
-
-  NMEA0183IOTask* nmea0183_io_task = new NMEA0183IOTask(&Serial1);
-
-  ApparentWindData* apparent_wind_data = new ApparentWindData();
-
-  ConnectApparentWind(&(nmea0183_io_task->parser_), apparent_wind_data);
-
-  // Connect the response parser
-  AutonnicPATCWIMWVParser* autonnic_response_parser =
-      new AutonnicPATCWIMWVParser(&(nmea0183_io_task->parser_));
+  /////////////////////////////////////////////////////////////////////
+  // Wind instrument selection
 
-  ReferenceAngleConfig* reference_angle_config = new ReferenceAngleConfig(
-      nmea0183_io_task, 0, autonnic_response_parser, "/Wind/Reference Angle");
+  CheckboxConfig* enable_bow_wind_config = new CheckboxConfig(
+      false, "Enable Bow Wind Sensor", "/Bow Wind/Enable");
 
-  ConfigItem(reference_angle_config)
-      ->set_title("Reference Angle")
+  ConfigItem(enable_bow_wind_config)
+      ->set_title("Enable Bow Wind Sensor")
       ->set_description(
-          "Reference angle offset for wind data (in degrees). "
-          "Enter the angle readout when the wind vane is pointing "
-          "straight ahead.")
-      ->set_sort_order(300);
-
-  WindDirectionDampingConfig* wind_direction_damping_config =
-      new WindDirectionDampingConfig(nmea0183_io_task, 50.0,
-                                     autonnic_response_parser,
-                                     "/Wind/Direction Damping");
-
-  ConfigItem(wind_direction_damping_config)
-      ->set_title("Wind Direction Damping")
-      ->set_description(
-          "Wind direction damping factor (0-100.0). Default is "
-          "50.0.")
-      ->set_sort_order(400);
-
-  WindSpeedDampingConfig* wind_speed_damping_config =
-      new WindSpeedDampingConfig(nmea0183_io_task, 50.0,
-                                 autonnic_response_parser,
-                                 "/Wind/Speed Damping");
-
-  ConfigItem(wind_speed_damping_config)
-      ->set_title("Wind Speed Damping")
-      ->set_description("Wind speed damping factor (0-100.0). Default is 50.0.")
-      ->set_sort_order(500);
-
-  WindOutputRepetitionRateConfig* wind_output_repetition_rate_config =
-      new WindOutputRepetitionRateConfig(nmea0183_io_task, 500,
-                                         autonnic_response_parser,
-                                         "/Wind/Message Repetition Rate");
-
-  ConfigItem(wind_output_repetition_rate_config)
-      ->set_title("Message Repetition Rate")
-      ->set_description(
-          "Wind message repetition rate in milliseconds. Default "
-          "is 500.")
-      ->set_sort_order(200);
+          "Enable a second wind sensor connected to the second RS485 "
+          "interface. This setting requires a device restart to take "
+          "effect.")
+      ->set_sort_order(150);
+
+  std::vector<WindInstrumentSettings> wind_instrument_settings = {
+      {"Masthead", "/Wind", "/SK Path", "environment.wind.speedApparent",
+       "environment.wind.angleApparent", &Serial1, kWindBitRate, kWindRxPin,
+       kWindTxPin, 0, kMastHeight, 200},
+  };
+  if (enable_bow_wind_config->get_value()) {
+    // SensESP sends all deltas of the device with the same $source, so on
+    // the standard apparent wind paths the bow sensor would overwrite the
+    // masthead values. Use separate default paths instead; they can be
+    // changed in the configuration.
+    wind_instrument_settings.push_back(
+        {"Bow", "/Bow Wind", "/SK Path/Bow",
+         "environment.wind.bow.speedApparent",
+         "environment.wind.bow.angleApparent", &Serial2, kWindBitRate,
+         kWind2RxPin, kWind2TxPin, 1, 0, 1200});
+  }
 
   /////////////////////////////////////////////////////////////////////
   // Initialize NMEA 2000 functionality
 
-  tNMEA2000* nmea2000 = new tNMEA2000_esp32(kCANTxPin, kCANRxPin);
+  RecoverableNMEA2000* nmea2000 = new RecoverableNMEA2000(kCANTxPin, kCANRxPin);
+
+  // Each wind sensor is transmitted as a separate NMEA 2000 device, since
+  // PGN 130306 has no instance field.
+  nmea2000->SetDeviceCount(wind_instrument_settings.size());
 
   // Reserve enough buffer for sending all messages.
   nmea2000->SetN2kCANSendFrameBufSize(250);
   nmea2000->SetN2kCANReceiveFrameBufSize(250);
 
-  // Set Product information
-  // EDIT: Change the values below to match your device.
-  nmea2000->SetProductInformation(
-      "20240601",  // Manufacturer's Model serial code (max 32 chars)
-      105,         // Manufacturer's product code
-      "Wind-N2K",  // Manufacturer's Model ID (max 33 chars)
-      "1.0.0",     // Manufacturer's Software version code (max 40 chars)
-      "1.0.0"      // Manufacturer's Model version (max 24 chars)
-  );
-
-  // For device class/function information, see:
-  // http://www.nmea.org/Assets/20120726%20nmea%202000%20class%20&%20function%20codes%20v%202.00.pdf
-
-  // For mfg registration list, see:
-  // https://actisense.com/nmea-certified-product-providers/
-  // The format is inconvenient, but the manufacturer code below should be
-  // one not already on the list.
-
-  // EDIT: Change the class and function values below to match your device.
-  nmea2000->SetDeviceInformation(
-      GetBoardSerialNumber(),  // Unique number. Use e.g. Serial number.
-      130,                     // Device function: Weather Instruments
-      85,                      // Device class: Sensor Communication Interface
-      2046);                   // Manufacturer code
+  for (int i = 0; i < (int)wind_instrument_settings.size(); i++) {
+    // Set Product information
+    // EDIT: Change the values below to match your device.
+    nmea2000->SetProductInformation(
+        "20240601",  // Manufacturer's Model serial code (max 32 chars)
+        105,         // Manufacturer's product code
+        "Wind-N2K",  // Manufacturer's Model ID (max 33 chars)
+        "1.0.0",     // Manufacturer's Software version code (max 40 chars)
+        "1.0.0",     // Manufacturer's Model version (max 24 chars)
+        0xff,        // Load equivalency
+        0xffff,      // NMEA 2000 version
+        0xff,        // Certification level
+        i);
+
+    // For device class/function information, see:
+    // http://www.nmea.org/Assets/20120726%20nmea%202000%20class%20&%20function%20codes%20v%202.00.pdf
+
+    // For mfg registration list, see:
+    // https://actisense.com/nmea-certified-product-providers/
+    // The format is inconvenient, but the manufacturer code below should be
+    // one not already on the list.
+
+    // EDIT: Change the class and function values below to match your device.
+    nmea2000->SetDeviceInformation(
+        GetBoardSerialNumber() + i,  // Unique number. Use e.g. Serial number.
+        130,   // Device function: Weather Instruments
+        85,    // Device class: Sensor Communication Interface
+        2046,  // Manufacturer code
+        4,     // Industry group: Marine
+        i);
+  }
 
   nmea2000->SetMode(tNMEA2000::N2km_NodeOnly,
                     72  // Default N2k node address
   );
   nmea2000->SetMsgHandler([](const tN2kMsg& msg) {
     n2k_rx_counter = n2k_rx_counter.get() + 1;
-    n2k_time_since_rx = 0;
   });
   nmea2000->EnableForward(false);
   nmea2000->Open();
@@ -196,62 +217,213 @@ void setup() {
   event_loop()->onRepeat(1, [nmea2000]() { nmea2000->ParseMessages(); });
 
   /////////////////////////////////////////////////////////////////////
-  // Initialize NMEA 2000 wind data sender
+  // Initialize link health supervision
 
-  N2kWindDataSender* wind_data_sender = new N2kWindDataSender(
-      "/Wind/NMEA2000", tN2kWindReference::N2kWind_Apparent, nmea2000, true);
+  CheckboxConfig* enable_n2k_watchdog_config = new CheckboxConfig(
+      false, "Enable Restart on Link Failure", "/NMEA2000/Enable Watchdog");
 
-  apparent_wind_data->speed.connect_to(&(wind_data_sender->wind_speed_));
+  ConfigItem(enable_n2k_watchdog_config)
+      ->set_title("Enable Restart on Link Failure")
+      ->set_description(
+          "Link faults (CAN bus-off, stalled NMEA 2000 transmissions, no "
+          "received NMEA 2000 messages, missing wind data) are always "
+          "recovered in place. If enabled, the device will additionally "
+          "reboot if an NMEA 2000 fault persists for two minutes despite the "
+          "recovery attempts. Wind sensor faults never cause a reboot. This "
+          "setting requires a device restart to take effect.")
+      ->set_sort_order(100);
 
-  apparent_wind_data->angle.connect_to(&(wind_data_sender->wind_angle_));
+  HealthSupervisor* health_supervisor =
+      new HealthSupervisor(enable_n2k_watchdog_config->get_value());
 
-  // wind_data_sender emits whenever it sends a message; count the messages
-  wind_data_sender->connect_to(new LambdaConsumer<std::pair<double, double>>(
-      [](std::pair<double, double> wind_data) {
-        n2k_tx_counter = n2k_tx_counter.get() + 1;
-        n2k_time_since_tx = 0;
-      }));
+  CANLink* can_link = health_supervisor->add_link(
+      new CANLink(nmea2000, kN2kTxTimeout, kN2kRxTimeout));
+
+  n2k_rx_counter.connect_to(
+      new LambdaConsumer<int>([can_link](int) { can_link->feed_rx(); }));
 
   /////////////////////////////////////////////////////////////////////
-  // Initialize the Signal K wind data sender
+  // Initialize the wind instruments
+
+  // Masthead motion compensation. The IMU feeding the motion accumulator
+  // is initialized at the end of setup().
+  MotionAccumulator* motion_accumulator = new MotionAccumulator();
+
+  std::vector<WindInstrument*> wind_instruments;
+  for (auto& settings : wind_instrument_settings) {
+    WindInstrument* wind_instrument = new WindInstrument(
+        settings, nmea2000, motion_accumulator, health_supervisor);
+    wind_instruments.push_back(wind_instrument);
+
+    // The senders emit whenever they have sent a message; count the messages
+    wind_instrument->wind_data_sender()->connect_to(
+        new LambdaConsumer<N2kWindDataSender::FieldTuple>(
+            [can_link](const N2kWindDataSender::FieldTuple& wind_data) {
+              n2k_tx_counter = n2k_tx_counter.get() + 1;
+              can_link->feed();
+            }));
+  }
 
-  auto apparent_wind_speed_sk_output = new SKOutputFloat(
-      "/SK Path/Apparent Wind Speed", "environment.wind.speedApparent",
-      new SKMetadata("Apparent Wind Speed", "m/s"));
+  /////////////////////////////////////////////////////////////////////
+  // Output rate demand of the NMEA 2000 and Signal K outputs
+
+  // Without other devices on the bus, nobody listens to PGN 130306
+  ObservableValue<int>* n2k_active = new ObservableValue<int>(0);
+  event_loop()->onRepeat(kN2kActivityTimeout, [n2k_active]() {
+    static int previous_count = 0;
+    int count = n2k_rx_counter.get();
+    n2k_active->set(count != previous_count);
+    previous_count = count;
+  });
 
-  auto apparent_wind_angle_sk_output = new SKOutputFloat(
-      "/SK Path/Apparent Wind Angle", "environment.wind.angleApparent",
-      new SKMetadata("Apparent Wind Angle", "rad"));
+  ObservableValue<int>* sk_connected = new ObservableValue<int>(0);
+  sensesp_app->get_ws_client()->connect_to(
+      new LambdaConsumer<SKWSConnectionState>(
+          [sk_connected](SKWSConnectionState state) {
+            sk_connected->set(state == SKWSConnectionState::kSKWSConnected);
+          }));
+
+  for (auto wind_instrument : wind_instruments) {
+    n2k_active->connect_to(
+        wind_instrument->rate_controller()->add_demand(kN2kDemandInterval));
+    sk_connected->connect_to(
+        wind_instrument->rate_controller()->add_demand(kSKDemandInterval));
+  }
 
-  apparent_wind_data->speed.connect_to(apparent_wind_speed_sk_output);
-  apparent_wind_data->angle.connect_to(apparent_wind_angle_sk_output);
+  // The masthead sensor feeds the display, the logger and the other
+  // outputs
+  ApparentWindData* apparent_wind_data = wind_instruments[0]->wind_data();
+  WindSampleJoiner* wind_samples = wind_instruments[0]->wind_samples();
 
   /////////////////////////////////////////////////////////////////////
-  // Configuration elements
+  // Forward the raw wind sentences to the network
 
-  CheckboxConfig* enable_n2k_watchdog_config = new CheckboxConfig(
-      false, "Enable NMEA 2000 Watchdog", "/NMEA2000/Enable Watchdog");
+  NMEA0183MuxService* nmea0183_mux = new NMEA0183MuxService(
+      false, kNMEA0183MuxPort, kNMEA0183MuxPort, "/NMEA 0183 Network");
 
-  ConfigItem(enable_n2k_watchdog_config)
-      ->set_title("Enable NMEA 2000 Watchdog")
+  ConfigItem(nmea0183_mux)
+      ->set_title("NMEA 0183 Network Output")
       ->set_description(
-          "Enable the NMEA 2000 watchdog. If enabled, the device will reboot "
-          "after two minutes if no NMEA 2000 messages are received. This "
-          "setting requires a device restart to take effect.")
-      ->set_sort_order(100);
+          "Forward the raw NMEA 0183 sentences of all wind sensors to TCP "
+          "clients and as UDP broadcasts. Set a port to 0 to disable that "
+          "transport.")
+      ->set_sort_order(800);
+
+  for (auto wind_instrument : wind_instruments) {
+    wind_instrument->nmea0183_io_task()->connect_to(
+        &(nmea0183_mux->sentence_input_));
+    // Network clients get every sentence the sensor sends
+    nmea0183_mux->clients_.connect_to(
+        wind_instrument->rate_controller()->add_demand(
+            kNMEA0183MuxDemandInterval));
+  }
 
-  if (enable_n2k_watchdog_config->get_value()) {
-    event_loop()->onRepeat(1000, [nmea2000]() {
-      if (n2k_time_since_rx > 120000) {
-        ESP_LOGE("NMEA2000", "No messages received in 2 minutes. Restarting.");
-        // All hope is lost; it doesn't matter if we delay for a bit to ensure
-        // the log message is sent.
-        delay(10);
-        ESP.restart();
-      }
-    });
+  nmea0183_mux->clients_.connect_to(
+      new StatusPageItem<int>("TCP Clients", 0, "NMEA 0183 Network", 800));
+  nmea0183_mux->dropped_sentences_.connect_to(new StatusPageItem<int>(
+      "Dropped Sentences", 0, "NMEA 0183 Network", 810));
+
+  /////////////////////////////////////////////////////////////////////
+  // Live wind stream for local dashboards
+
+  WindStream* wind_stream = new WindStream();
+  wind_samples->connect_to(&(wind_stream->wind_input_));
+  wind_stream->add_http_handler(sensesp_app->get_http_server().get());
+  wind_stream->subscribers_.connect_to(
+      wind_instruments[0]->rate_controller()->add_demand(
+          kWindStreamDemandInterval));
+
+  wind_stream->subscribers_.connect_to(
+      new StatusPageItem<int>("Subscribers", 0, "Wind Stream", 900));
+  wind_stream->dropped_frames_.connect_to(
+      new StatusPageItem<int>("Dropped Frames", 0, "Wind Stream", 910));
+
+  /////////////////////////////////////////////////////////////////////
+  // NMEA 0183 output for legacy displays and autopilots
+
+  CheckboxConfig* enable_nmea0183_output_config = new CheckboxConfig(
+      false, "Enable NMEA 0183 Output", "/NMEA 0183 Output/Enable");
+
+  ConfigItem(enable_nmea0183_output_config)
+      ->set_title("Enable NMEA 0183 Output")
+      ->set_description(
+          "Send the corrected masthead wind as MWV and VWR sentences on the "
+          "second RS485 interface. Not available when the bow wind sensor "
+          "is enabled. This setting requires a device restart to take "
+          "effect.")
+      ->set_sort_order(1000);
+
+  if (enable_nmea0183_output_config->get_value()) {
+    if (enable_bow_wind_config->get_value()) {
+      ESP_LOGW("NMEA0183Output",
+               "The second RS485 interface is used by the bow wind sensor");
+    } else {
+      Serial2.begin(kWindBitRate, SERIAL_8N1, -1, kWind2TxPin);
+      NMEA0183WindOutput* nmea0183_output =
+          new NMEA0183WindOutput(&Serial2, motion_accumulator,
+                                 "/NMEA 0183 Output/Settings");
+
+      ConfigItem(nmea0183_output)
+          ->set_title("NMEA 0183 Output")
+          ->set_description(
+              "Sentence intervals, smoothing and the upwash correction "
+              "table. The table has points every 15 degrees from 0 to 180 "
+              "degrees of starboard apparent wind angle and is mirrored for "
+              "port. Angle offsets are added to the wind angle (towards "
+              "the stern on both tacks when positive); speed factors "
+              "multiply the wind speed. The geometric effect of heel, "
+              "measured by the IMU, is corrected automatically. The heel "
+              "tables add a residual correction with one row for every 5 "
+              "degrees from 0 to 30 degrees of heel, each with points at "
+              "the same wind angles as the upwash table.")
+          ->set_sort_order(1010);
+
+      wind_samples->connect_to(&(nmea0183_output->wind_input_));
+      // The output is fed by the masthead sensor, which has to send at
+      // least as often as the fastest sentence
+      nmea0183_output->set_demand(
+          wind_instruments[0]->rate_controller()->add_demand(
+              nmea0183_output->get_demand_interval()));
+
+      nmea0183_output->sentences_sent_.connect_to(new StatusPageItem<int>(
+          "Sent Sentences", 0, "NMEA 0183 Output", 1000));
+      nmea0183_output->sentences_dropped_.connect_to(new StatusPageItem<int>(
+          "Dropped Sentences", 0, "NMEA 0183 Output", 1010));
+    }
+  }
+
+  /////////////////////////////////////////////////////////////////////
+  // Initialize the wind data logger
+
+  CheckboxConfig* enable_wind_logger_config = new CheckboxConfig(
+      false, "Enable Wind Logging", "/Logger/Enable");
+
+  ConfigItem(enable_wind_logger_config)
+      ->set_title("Enable Wind Logging")
+      ->set_description(
+          "Log apparent wind into the on-device flash ring buffer. The log "
+          "can be downloaded at /api/windlog. This setting requires a device "
+          "restart to take effect.")
+      ->set_sort_order(700);
+
+  if (enable_wind_logger_config->get_value()) {
+    WindLogger* wind_logger = new WindLogger();
+    wind_samples->connect_to(&(wind_logger->wind_input_));
+    wind_logger->add_http_handler(sensesp_app->get_http_server().get());
+
+    wind_logger->status_.connect_to(
+        new StatusPageItem<String>("Status", "", "Wind Log", 490));
+    wind_logger->samples_logged_.connect_to(
+        new StatusPageItem<int>("Logged Samples", 0, "Wind Log", 500));
+    wind_logger->sectors_written_.connect_to(
+        new StatusPageItem<int>("Written Sectors", 0, "Wind Log", 510));
+    wind_logger->sectors_dropped_.connect_to(
+        new StatusPageItem<int>("Dropped Sectors", 0, "Wind Log", 520));
   }
 
+  /////////////////////////////////////////////////////////////////////
+  // Status page items
+
   auto n2k_rx_ui_output = new StatusPageItem<int>("NMEA 2000 Received Messages",
                                                   0, "NMEA 2000", 300);
 
@@ -262,6 +434,37 @@ void setup() {
 
   n2k_tx_counter.connect_to(n2k_tx_ui_output);
 
+  can_link->recoveries_.connect_to(new StatusPageItem<int>(
+      "NMEA 2000 Recoveries", 0, "Link Health", 320));
+
+  health_supervisor->last_recovery_time_.connect_to(new StatusPageItem<int>(
+      "Last Recovery Time (ms)", 0, "Link Health", 340));
+
+  int sort_order = 600;
+  for (auto wind_instrument : wind_instruments) {
+    const String& name = wind_instrument->get_name();
+    wind_instrument->serial_link()->recoveries_.connect_to(
+        new StatusPageItem<int>(name + " Wind Sensor Recoveries", 0,
+                                "Link Health", sort_order));
+    wind_instrument->heap_usage_.connect_to(new StatusPageItem<int>(
+        name + " Heap Usage (bytes)", 0, "Wind Instruments", sort_order + 1));
+    wind_instrument->processing_time_.connect_to(new StatusPageItem<float>(
+        name + " Processing Time (us)", 0, "Wind Instruments",
+        sort_order + 2));
+    AdaptiveRateController* rate_controller =
+        wind_instrument->rate_controller();
+    rate_controller->output_interval_.connect_to(new StatusPageItem<int>(
+        name + " Output Interval (ms)", 0, "Wind Instruments",
+        sort_order + 3));
+    rate_controller->sample_rate_.connect_to(new StatusPageItem<float>(
+        name + " Sample Rate (Hz)", 0, "Wind Instruments", sort_order + 4));
+    rate_controller->rate_changes_.connect_to(new StatusPageItem<int>(
+        name + " Rate Changes", 0, "Wind Instruments", sort_order + 5));
+    rate_controller->variability_.connect_to(new StatusPageItem<float>(
+        name + " Wind Variability", 0, "Wind Instruments", sort_order + 6));
+    sort_order += 10;
+  }
+
   /////////////////////////////////////////////////////////////////////
   // Initialize the OLED display
 
@@ -272,7 +475,22 @@ void setup() {
       &(display->apparent_wind_angle_consumer));
 
   /////////////////////////////////////////////////////////////////////
-  // TODO: Initialize the ICM-20948 IMU
+  // Initialize the ICM-20948 IMU
+
+  ICM20948* imu = new ICM20948(&Wire, kImuAddress);
+  if (imu->begin()) {
+    ImuReader* imu_reader = new ImuReader(imu, motion_accumulator);
+    imu_reader->start();
+
+    imu_reader->sample_rate_.connect_to(
+        new StatusPageItem<int>("IMU Sample Rate (Hz)", 0, "IMU", 400));
+    auto heel_status = new StatusPageItem<float>("Heel (deg)", 0, "IMU", 410);
+    event_loop()->onRepeat(1000, [motion_accumulator, heel_status]() {
+      heel_status->set(motion_accumulator->heel() * (180 / M_PI));
+    });
+  } else {
+    ESP_LOGW("IMU", "ICM-20948 not found; motion compensation unavailable");
+  }
 }
 
 void loop() { event_loop()->tick(); }
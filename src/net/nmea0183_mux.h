@@ -0,0 +1,280 @@
+#ifndef AUTONNIC_WIND_SRC_NET_NMEA0183_MUX_H_
+#define AUTONNIC_WIND_SRC_NET_NMEA0183_MUX_H_
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace wind_interface {
+
+#ifdef MSG_NOSIGNAL
+// Don't raise SIGPIPE on hosts when a client has disconnected
+constexpr int kMuxSendFlags = MSG_DONTWAIT | MSG_NOSIGNAL;
+#else
+constexpr int kMuxSendFlags = MSG_DONTWAIT;
+#endif
+
+/**
+ * @brief Forwards raw NMEA 0183 sentences as UDP broadcasts and to TCP
+ * clients.
+ *
+ * Sentences are sent straight from the caller's line buffer. Only when a
+ * TCP client cannot accept the data immediately is the remainder copied
+ * into that client's bounded send queue. A sentence that does not fit into
+ * the queue is dropped for that client, so a slow client never blocks the
+ * caller or the other clients.
+ *
+ * forward() and poll() must be called from the same thread.
+ */
+class NMEA0183Mux {
+ public:
+  static constexpr int kMaxClients = 4;
+  static constexpr size_t kQueueSize = 2048;
+
+  ~NMEA0183Mux() { end(); }
+
+  /**
+   * @brief Open the sockets.
+   *
+   * @param tcp_port TCP listening port, or 0 to disable TCP
+   * @param udp_port UDP broadcast port, or 0 to disable UDP
+   * @param udp_address UDP destination address, in network byte order
+   * @return false if a socket could not be opened
+   */
+  bool begin(uint16_t tcp_port, uint16_t udp_port,
+             uint32_t udp_address = INADDR_BROADCAST) {
+    end();
+    if (tcp_port != 0) {
+      listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+      if (listen_fd_ < 0) {
+        return false;
+      }
+      int one = 1;
+      setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+      sockaddr_in addr = {};
+      addr.sin_family = AF_INET;
+      addr.sin_port = htons(tcp_port);
+      addr.sin_addr.s_addr = htonl(INADDR_ANY);
+      if (bind(listen_fd_, (sockaddr*)&addr, sizeof(addr)) != 0 ||
+          listen(listen_fd_, kMaxClients) != 0) {
+        end();
+        return false;
+      }
+      set_nonblocking(listen_fd_);
+    }
+    if (udp_port != 0) {
+      udp_fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+      if (udp_fd_ < 0) {
+        end();
+        return false;
+      }
+      int one = 1;
+      setsockopt(udp_fd_, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+      set_nonblocking(udp_fd_);
+      udp_addr_ = {};
+      udp_addr_.sin_family = AF_INET;
+      udp_addr_.sin_port = htons(udp_port);
+      udp_addr_.sin_addr.s_addr = udp_address;
+    }
+    return true;
+  }
+
+  void end() {
+    for (auto& client : clients_) {
+      close_client(client);
+    }
+    if (listen_fd_ >= 0) {
+      close(listen_fd_);
+      listen_fd_ = -1;
+    }
+    if (udp_fd_ >= 0) {
+      close(udp_fd_);
+      udp_fd_ = -1;
+    }
+  }
+
+  /**
+   * @brief Forward a single sentence. CR LF is appended if the line does
+   * not already end with a line feed.
+   */
+  void forward(const char* line, size_t len) {
+    static const char kCRLF[] = "\r\n";
+    iovec iov[2];
+    iov[0].iov_base = (void*)line;
+    iov[0].iov_len = len;
+    iov[1].iov_base = (void*)kCRLF;
+    iov[1].iov_len = (len > 0 && line[len - 1] == '\n') ? 0 : 2;
+    size_t total = iov[0].iov_len + iov[1].iov_len;
+
+    if (udp_fd_ >= 0) {
+      msghdr msg = {};
+      msg.msg_name = &udp_addr_;
+      msg.msg_namelen = sizeof(udp_addr_);
+      msg.msg_iov = iov;
+      msg.msg_iovlen = 2;
+      sendmsg(udp_fd_, &msg, kMuxSendFlags);
+    }
+
+    for (auto& client : clients_) {
+      if (client.fd < 0) {
+        continue;
+      }
+      size_t sent = 0;
+      if (client.queued == 0) {
+        // Nothing is waiting; try to send without copying
+        msghdr msg = {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = 2;
+        ssize_t result = sendmsg(client.fd, &msg, kMuxSendFlags);
+        if (result < 0) {
+          if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            close_client(client);
+            continue;
+          }
+        } else {
+          sent = result;
+        }
+      }
+      if (sent == total) {
+        continue;
+      }
+      if (total - sent > kQueueSize - client.queued) {
+        dropped_sentences_++;
+        continue;
+      }
+      // Queue whatever the socket did not accept
+      for (int i = 0; i < 2; i++) {
+        const char* data = (const char*)iov[i].iov_base;
+        size_t data_len = iov[i].iov_len;
+        if (sent >= data_len) {
+          sent -= data_len;
+          continue;
+        }
+        enqueue(client, data + sent, data_len - sent);
+        sent = 0;
+      }
+    }
+  }
+
+  /**
+   * @brief Accept new clients and flush the send queues. Call periodically.
+   */
+  void poll() {
+    if (listen_fd_ >= 0) {
+      int fd;
+      while ((fd = accept(listen_fd_, nullptr, nullptr)) >= 0) {
+        Client* slot = nullptr;
+        for (auto& client : clients_) {
+          if (client.fd < 0) {
+            slot = &client;
+            break;
+          }
+        }
+        if (slot == nullptr) {
+          close(fd);
+          continue;
+        }
+        set_nonblocking(fd);
+        slot->fd = fd;
+        slot->head = 0;
+        slot->queued = 0;
+      }
+    }
+
+    for (auto& client : clients_) {
+      if (client.fd < 0) {
+        continue;
+      }
+      // Detect closed connections. Any data sent by the client is ignored.
+      char discard[32];
+      ssize_t received = recv(client.fd, discard, sizeof(discard),
+                              MSG_DONTWAIT);
+      if (received == 0 ||
+          (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        close_client(client);
+        continue;
+      }
+      flush(client);
+    }
+  }
+
+  int get_num_clients() const {
+    int count = 0;
+    for (auto& client : clients_) {
+      if (client.fd >= 0) {
+        count++;
+      }
+    }
+    return count;
+  }
+
+  /// Sentences dropped because a client send queue was full
+  unsigned long get_dropped_sentences() const { return dropped_sentences_; }
+
+ protected:
+  struct Client {
+    int fd = -1;
+    size_t head = 0;    // Index of the first queued byte
+    size_t queued = 0;  // Number of queued bytes
+    char queue[kQueueSize];
+  };
+
+  static void set_nonblocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  }
+
+  static void enqueue(Client& client, const char* data, size_t len) {
+    size_t tail = (client.head + client.queued) % kQueueSize;
+    size_t first = len < kQueueSize - tail ? len : kQueueSize - tail;
+    memcpy(client.queue + tail, data, first);
+    memcpy(client.queue, data + first, len - first);
+    client.queued += len;
+  }
+
+  void flush(Client& client) {
+    while (client.queued > 0) {
+      size_t contiguous = kQueueSize - client.head;
+      size_t len = client.queued < contiguous ? client.queued : contiguous;
+      ssize_t sent = send(client.fd, client.queue + client.head, len,
+                          kMuxSendFlags);
+      if (sent < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+          close_client(client);
+        }
+        return;
+      }
+      client.head = (client.head + sent) % kQueueSize;
+      client.queued -= sent;
+      if ((size_t)sent < len) {
+        return;
+      }
+    }
+  }
+
+  static void close_client(Client& client) {
+    if (client.fd >= 0) {
+      close(client.fd);
+      client.fd = -1;
+    }
+    client.head = 0;
+    client.queued = 0;
+  }
+
+  int listen_fd_ = -1;
+  int udp_fd_ = -1;
+  sockaddr_in udp_addr_ = {};
+  Client clients_[kMaxClients];
+  unsigned long dropped_sentences_ = 0;
+};
+
+}  // namespace wind_interface
+
+#endif  // AUTONNIC_WIND_SRC_NET_NMEA0183_MUX_H_
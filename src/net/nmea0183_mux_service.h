@@ -0,0 +1,122 @@
+#ifndef AUTONNIC_WIND_SRC_NET_NMEA0183_MUX_SERVICE_H_
+#define AUTONNIC_WIND_SRC_NET_NMEA0183_MUX_SERVICE_H_
+
+#include <WiFi.h>
+
+#include "nmea0183_mux.h"
+#include "sensesp.h"
+#include "sensesp/system/lambda_consumer.h"
+#include "sensesp/system/observablevalue.h"
+#include "sensesp/system/saveable.h"
+#include "sensesp/system/serializable.h"
+
+namespace wind_interface {
+
+/**
+ * @brief Makes raw NMEA 0183 sentences available on the network.
+ *
+ * Connect NMEA0183IOTask line outputs to sentence_input_. The line is
+ * handed to NMEA0183Mux as is, without parsing or copying. The sockets are
+ * opened once the network is up and reopened after configuration changes.
+ */
+class NMEA0183MuxService : public sensesp::FileSystemSaveable,
+                           virtual public sensesp::Serializable {
+ public:
+  NMEA0183MuxService(bool enabled, uint16_t tcp_port, uint16_t udp_port,
+                     String config_path = "")
+      : sensesp::FileSystemSaveable(config_path),
+        sensesp::Serializable(),
+        enabled_{enabled},
+        tcp_port_{tcp_port},
+        udp_port_{udp_port} {
+    load();
+    sensesp::event_loop()->onRepeat(kPollInterval, [this]() { poll(); });
+  }
+
+  sensesp::LambdaConsumer<String> sentence_input_{[this](const String& line) {
+    if (open_) {
+      mux_.forward(line.c_str(), line.length());
+    }
+  }};
+
+  sensesp::ObservableValue<int> clients_ = 0;
+  sensesp::ObservableValue<int> dropped_sentences_ = 0;
+
+  inline virtual bool to_json(JsonObject& doc) override {
+    doc["enabled"] = enabled_;
+    doc["tcp_port"] = tcp_port_;
+    doc["udp_port"] = udp_port_;
+    return true;
+  }
+
+  inline virtual bool from_json(const JsonObject& config) override {
+    String expected_keys[] = {"enabled", "tcp_port", "udp_port"};
+    for (auto& key : expected_keys) {
+      if (!config[key].is<JsonVariant>()) {
+        return false;
+      }
+    }
+    enabled_ = config["enabled"];
+    tcp_port_ = config["tcp_port"];
+    udp_port_ = config["udp_port"];
+    reopen_ = true;
+    return true;
+  }
+
+ protected:
+  static constexpr unsigned long kPollInterval = 10;
+
+  void poll() {
+    bool connected = WiFi.status() == WL_CONNECTED;
+    if (open_ && (reopen_ || !connected)) {
+      mux_.end();
+      open_ = false;
+    }
+    if (!open_ && enabled_ && connected) {
+      open_ = mux_.begin(tcp_port_, udp_port_);
+      if (!open_) {
+        ESP_LOGE("NMEA0183Mux", "Opening ports %d/%d failed", tcp_port_,
+                 udp_port_);
+        mux_.end();
+        enabled_ = false;
+      }
+    }
+    reopen_ = false;
+    if (!open_) {
+      return;
+    }
+
+    mux_.poll();
+
+    if (clients_.get() != mux_.get_num_clients()) {
+      clients_ = mux_.get_num_clients();
+    }
+    if (dropped_sentences_.get() != (int)mux_.get_dropped_sentences()) {
+      dropped_sentences_ = mux_.get_dropped_sentences();
+    }
+  }
+
+  NMEA0183Mux mux_;
+  bool open_ = false;
+  bool reopen_ = false;
+
+  bool enabled_;
+  uint16_t tcp_port_;
+  uint16_t udp_port_;
+};
+
+inline const String ConfigSchema(const NMEA0183MuxService& obj) {
+  const char schema[] = R"({
+      "type": "object",
+      "properties": {
+        "enabled": { "title": "Enabled", "type": "boolean" },
+        "tcp_port": { "title": "TCP Port (0 to disable)", "type": "integer" },
+        "udp_port": { "title": "UDP Broadcast Port (0 to disable)", "type": "integer" }
+      }
+    })";
+  return schema;
+}
+
+}  // namespace wind_interface
+
+#endif  // AUTONNIC_WIND_SRC_NET_NMEA0183_MUX_SERVICE_H_
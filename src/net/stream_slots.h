@@ -0,0 +1,171 @@
+#ifndef AUTONNIC_WIND_SRC_NET_STREAM_SLOTS_H_
+#define AUTONNIC_WIND_SRC_NET_STREAM_SLOTS_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+
+namespace wind_interface {
+
+/**
+ * @brief Fixed set of stream subscriber slots.
+ *
+ * The producer side, queue(), runs in the event loop and copies a frame
+ * into every slot whose interval has elapsed. The consumer side, flush(),
+ * runs in the HTTP server task and sends the queued frames. The pending
+ * flag hands a slot over between the two, so a frame buffer is never
+ * written while it is being sent.
+ */
+class StreamSlots {
+ public:
+  static constexpr int kMaxSlots = 4;
+  static constexpr size_t kFrameSize = 64;
+
+  enum class SendResult {
+    kSent,
+    kWouldBlock,  // Socket buffer full, nothing was sent
+    kFailed,      // Error or partial send, the stream can't be continued
+  };
+
+  struct Slot {
+    std::atomic<bool> active{false};
+    // Set by queue() when the buffer holds a frame to send, cleared by
+    // flush() once it has been handled
+    std::atomic<bool> pending{false};
+    // Set when a send failed and the session is being closed
+    std::atomic<bool> closing{false};
+    int fd = -1;
+    unsigned long interval = 0;  // Minimum time between frames, in ms
+    bool has_sent = false;
+    unsigned long last_sent = 0;
+    size_t len = 0;
+    char buffer[kFrameSize];
+  };
+
+  /**
+   * @brief Claim a free slot.
+   *
+   * @param fd Socket of the subscriber
+   * @param interval Minimum time between frames, in ms
+   * @return The slot, or nullptr if all slots are in use
+   */
+  Slot* acquire(int fd, unsigned long interval) {
+    for (auto& slot : slots_) {
+      if (slot.active.load(std::memory_order_acquire) ||
+          slot.pending.load(std::memory_order_acquire)) {
+        continue;
+      }
+      slot.fd = fd;
+      slot.interval = interval;
+      slot.has_sent = false;
+      slot.closing.store(false, std::memory_order_relaxed);
+      slot.active.store(true, std::memory_order_release);
+      return &slot;
+    }
+    return nullptr;
+  }
+
+  /// Free a slot once its session has been closed
+  static void release(Slot* slot) {
+    slot->active.store(false, std::memory_order_release);
+    slot->fd = -1;
+  }
+
+  /**
+   * @brief Queue a frame for every subscriber that is due.
+   *
+   * A subscriber whose previous frame has not been sent yet skips this
+   * one, and the frame is counted as dropped.
+   *
+   * @param now Current time, in ms
+   * @param encode Called as encode(buffer, kFrameSize), at most once and
+   * only if a subscriber is due. Returns the frame length like snprintf().
+   * @return Number of subscribers the frame was queued for
+   */
+  template <typename Encode>
+  int queue(unsigned long now, Encode encode) {
+    char frame[kFrameSize];
+    int len = -1;
+    int queued = 0;
+    for (auto& slot : slots_) {
+      if (!slot.active.load(std::memory_order_acquire) ||
+          slot.closing.load(std::memory_order_acquire) ||
+          (slot.has_sent && now - slot.last_sent < slot.interval)) {
+        continue;
+      }
+      if (slot.pending.load(std::memory_order_acquire)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+      if (len < 0) {
+        len = encode(frame, sizeof(frame));
+        if (len < 0) {
+          return queued;
+        }
+        // snprintf() returns the length the frame would have had untruncated
+        if (len > (int)sizeof(frame) - 1) {
+          len = sizeof(frame) - 1;
+        }
+      }
+      memcpy(slot.buffer, frame, len);
+      slot.len = len;
+      slot.last_sent = now;
+      slot.has_sent = true;
+      slot.pending.store(true, std::memory_order_release);
+      queued++;
+    }
+    return queued;
+  }
+
+  /**
+   * @brief Send the queued frames.
+   *
+   * @param send Called as send(fd, buffer, len) for every queued frame;
+   * must not block. A frame that would block is dropped for that
+   * subscriber only.
+   * @param close Called with the socket of a subscriber whose send failed
+   */
+  template <typename Send, typename Close>
+  void flush(Send send, Close close) {
+    for (auto& slot : slots_) {
+      if (!slot.pending.load(std::memory_order_acquire)) {
+        continue;
+      }
+      if (slot.active.load(std::memory_order_acquire)) {
+        switch (send(slot.fd, slot.buffer, slot.len)) {
+          case SendResult::kSent:
+            break;
+          case SendResult::kWouldBlock:
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            break;
+          case SendResult::kFailed:
+            slot.closing.store(true, std::memory_order_release);
+            close(slot.fd);
+            break;
+        }
+      }
+      slot.pending.store(false, std::memory_order_release);
+    }
+  }
+
+  int active_count() const {
+    int count = 0;
+    for (auto& slot : slots_) {
+      if (slot.active.load(std::memory_order_acquire)) {
+        count++;
+      }
+    }
+    return count;
+  }
+
+  /// Frames not delivered because the subscriber was not ready
+  int dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ protected:
+  Slot slots_[kMaxSlots];
+  std::atomic<int> dropped_{0};
+};
+
+}  // namespace wind_interface
+
+#endif  // AUTONNIC_WIND_SRC_NET_STREAM_SLOTS_H_
@@ -0,0 +1,160 @@
+#ifndef AUTONNIC_WIND_SRC_NET_WIND_STREAM_H_
+#define AUTONNIC_WIND_SRC_NET_WIND_STREAM_H_
+
+#include <errno.h>
+#include <esp_http_server.h>
+#include <sys/socket.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+#include "net/stream_slots.h"
+#include "sensesp.h"
+#include "sensesp/net/http_server.h"
+#include "sensesp/system/lambda_consumer.h"
+#include "sensesp/system/observablevalue.h"
+#include "wind_sample.h"
+
+namespace wind_interface {
+
+/**
+ * @brief Streams wind samples to HTTP clients as Server-Sent Events.
+ *
+ * Each sample is a single event with a minimal JSON payload:
+ *
+ *   data:{"t":123456,"s":5.32,"a":0.7854}
+ *
+ * where t is the device uptime in ms, s the wind speed in m/s and a the
+ * wind angle in radians. Clients can limit the event rate with the
+ * interval query parameter, e.g. /api/wind/stream?interval=500.
+ *
+ * Subscribers occupy a fixed number of preallocated slots. The event loop
+ * only encodes the frame and hands it to the HTTP server task, which does
+ * the socket I/O without blocking. A frame that is due while the previous
+ * one is still queued, or that doesn't fit in the subscriber's socket
+ * buffer, is dropped for that subscriber only, so a slow client delays
+ * neither the event loop nor the other subscribers.
+ */
+class WindStream {
+ public:
+  WindStream() {
+    sensesp::event_loop()->onRepeat(1000, [this]() {
+      int count = slots_.active_count();
+      if (subscribers_.get() != count) {
+        subscribers_ = count;
+      }
+      int dropped = slots_.dropped();
+      if (dropped_frames_.get() != dropped) {
+        dropped_frames_ = dropped;
+      }
+    });
+  }
+
+  sensesp::LambdaConsumer<WindSample> wind_input_{
+      [this](const WindSample& sample) { add_sample(sample); }};
+
+  /// Register the stream handler at the given URI
+  void add_http_handler(sensesp::HTTPServer* server,
+                        const char* uri = "/api/wind/stream") {
+    auto handler = std::make_shared<sensesp::HTTPRequestHandler>(
+        1 << HTTP_GET, uri,
+        [this](httpd_req_t* req) { return handle_subscribe(req); });
+    server->add_handler(handler);
+  }
+
+  sensesp::ObservableValue<int> subscribers_ = 0;
+  /// Frames skipped because the subscriber was not ready for them
+  sensesp::ObservableValue<int> dropped_frames_ = 0;
+
+ protected:
+  void add_sample(const WindSample& sample) {
+    unsigned long now = millis();
+    int queued = slots_.queue(now, [&](char* buffer, size_t size) {
+      return snprintf(buffer, size,
+                      "data:{\"t\":%lu,\"s\":%.2f,\"a\":%.4f}\n\n", now,
+                      sample.speed, sample.angle);
+    });
+    if (queued > 0 && !work_queued_.exchange(true)) {
+      if (httpd_queue_work(server_handle_, send_work, this) != ESP_OK) {
+        work_queued_ = false;
+      }
+    }
+  }
+
+  /// Runs in the HTTP server task
+  static void send_work(void* arg) {
+    WindStream* stream = static_cast<WindStream*>(arg);
+    stream->work_queued_ = false;
+    stream->slots_.flush(
+        [](int fd, const char* buffer, size_t len) {
+          // Never wait for a slow subscriber: that would stall the server
+          // task and with it every other subscriber
+          int sent = send(fd, buffer, len, MSG_DONTWAIT);
+          if (sent == (int)len) {
+            return StreamSlots::SendResult::kSent;
+          }
+          if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return StreamSlots::SendResult::kWouldBlock;
+          }
+          // A partial frame would corrupt the event stream, so a short
+          // send is treated as an error as well
+          return StreamSlots::SendResult::kFailed;
+        },
+        [stream](int fd) {
+          httpd_sess_trigger_close(stream->server_handle_, fd);
+        });
+  }
+
+  /// Called by the HTTP server task when a subscriber session is closed
+  static void release_slot(void* ctx) {
+    StreamSlots::release(static_cast<StreamSlots::Slot*>(ctx));
+  }
+
+  esp_err_t handle_subscribe(httpd_req_t* req) {
+    unsigned long interval = 0;
+    char query[32];
+    char value[8];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "interval", value, sizeof(value)) ==
+            ESP_OK) {
+      interval = strtoul(value, nullptr, 10);
+    }
+
+    StreamSlots::Slot* slot =
+        slots_.acquire(httpd_req_to_sockfd(req), interval);
+    if (slot == nullptr) {
+      httpd_resp_set_status(req, "503 Service Unavailable");
+      return httpd_resp_sendstr(req, "Too many subscribers");
+    }
+
+    // The response never ends, so the headers are sent directly instead of
+    // through httpd_resp_send. Frames are only sent by send_work(), which
+    // runs in this same task, so they can't overtake the headers.
+    static const char kHeaders[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/event-stream\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Access-Control-Allow-Origin: *\r\n"
+        "\r\n";
+    if (httpd_send(req, kHeaders, sizeof(kHeaders) - 1) < 0) {
+      StreamSlots::release(slot);
+      return ESP_FAIL;
+    }
+
+    server_handle_ = req->handle;
+    // Free the slot when the client disconnects
+    req->sess_ctx = slot;
+    req->free_ctx = release_slot;
+    return ESP_OK;
+  }
+
+  StreamSlots slots_;
+  httpd_handle_t server_handle_ = nullptr;
+  std::atomic<bool> work_queued_{false};
+};
+
+}  // namespace wind_interface
+
+#endif  // AUTONNIC_WIND_SRC_NET_WIND_STREAM_H_
@@ -0,0 +1,164 @@
+#ifndef AUTONNIC_WIND_SRC_OUTPUT_NMEA0183_ENCODER_H_
+#define AUTONNIC_WIND_SRC_OUTPUT_NMEA0183_ENCODER_H_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace wind_interface {
+
+/**
+ * @brief Builds a single NMEA 0183 sentence in a caller provided buffer.
+ *
+ * The checksum is updated as characters are appended, and numbers are
+ * formatted without printf.
+ */
+class NMEA0183SentenceBuilder {
+ public:
+  // Maximum sentence length including the terminating CR LF
+  static constexpr size_t kMaxLength = 82;
+
+  /**
+   * @param buf Buffer of at least kMaxLength bytes
+   * @param address Talker and sentence identifier, e.g. "IIMWV"
+   */
+  NMEA0183SentenceBuilder(char* buf, const char* address) : buf_{buf} {
+    buf_[len_++] = '$';
+    append(address);
+  }
+
+  NMEA0183SentenceBuilder& field(const char* text) {
+    put(',');
+    append(text);
+    return *this;
+  }
+
+  NMEA0183SentenceBuilder& field(char c) {
+    put(',');
+    put(c);
+    return *this;
+  }
+
+  /// Append a fixed point number with the given number of decimals
+  NMEA0183SentenceBuilder& field(float value, int decimals) {
+    put(',');
+    static const long kScale[] = {1, 10, 100, 1000};
+    long scale = kScale[decimals];
+    long scaled = lroundf(value * scale);
+    if (scaled < 0) {
+      put('-');
+      scaled = -scaled;
+    }
+    put_integer(scaled / scale);
+    if (decimals > 0) {
+      put('.');
+      long fraction = scaled % scale;
+      for (long divisor = scale / 10; divisor > 0; divisor /= 10) {
+        put('0' + (fraction / divisor) % 10);
+      }
+    }
+    return *this;
+  }
+
+  /// Append the checksum and CR LF. @return Sentence length
+  size_t finish() {
+    static const char kHex[] = "0123456789ABCDEF";
+    uint8_t checksum = checksum_;
+    buf_[len_++] = '*';
+    buf_[len_++] = kHex[checksum >> 4];
+    buf_[len_++] = kHex[checksum & 0x0F];
+    buf_[len_++] = '\r';
+    buf_[len_++] = '\n';
+    return len_;
+  }
+
+ protected:
+  void put(char c) {
+    // Leave room for the checksum and CR LF
+    if (len_ < kMaxLength - 5) {
+      buf_[len_++] = c;
+      checksum_ ^= c;
+    }
+  }
+
+  void append(const char* text) {
+    while (*text) {
+      put(*text++);
+    }
+  }
+
+  void put_integer(long value) {
+    char digits[12];
+    int n = 0;
+    do {
+      digits[n++] = '0' + value % 10;
+      value /= 10;
+    } while (value > 0);
+    while (n > 0) {
+      put(digits[--n]);
+    }
+  }
+
+  char* buf_;
+  size_t len_ = 0;
+  uint8_t checksum_ = 0;
+};
+
+constexpr float kMetersPerSecondToKnots = 3600.0 / 1852.0;
+
+/**
+ * @brief Encode an MWV (wind speed and angle) sentence.
+ *
+ * @param buf Buffer of at least NMEA0183SentenceBuilder::kMaxLength bytes
+ * @param speed Wind speed, in m/s
+ * @param angle Wind angle, in degrees, 0 to 360
+ * @param valid false to encode a void sentence
+ * @return Sentence length
+ */
+inline size_t EncodeMWV(char* buf, float speed, float angle,
+                        bool valid = true, char reference = 'R') {
+  NMEA0183SentenceBuilder builder(buf, "IIMWV");
+  if (!valid) {
+    return builder.field("").field(reference).field("").field('N').field('V')
+        .finish();
+  }
+  if (angle >= 359.95f) {
+    angle = 0;
+  }
+  return builder.field(angle, 1)
+      .field(reference)
+      .field(speed * kMetersPerSecondToKnots, 1)
+      .field('N')
+      .field('A')
+      .finish();
+}
+
+/**
+ * @brief Encode a VWR (relative wind speed and angle) sentence.
+ *
+ * @param buf Buffer of at least NMEA0183SentenceBuilder::kMaxLength bytes
+ * @param speed Wind speed, in m/s
+ * @param angle Wind angle, in degrees, 0 to 360
+ * @return Sentence length
+ */
+inline size_t EncodeVWR(char* buf, float speed, float angle) {
+  char side = 'R';
+  if (angle > 180) {
+    angle = 360 - angle;
+    side = 'L';
+  }
+  return NMEA0183SentenceBuilder(buf, "IIVWR")
+      .field(angle, 1)
+      .field(side)
+      .field(speed * kMetersPerSecondToKnots, 1)
+      .field('N')
+      .field(speed, 1)
+      .field('M')
+      .field(speed * 3.6f, 1)
+      .field('K')
+      .finish();
+}
+
+}  // namespace wind_interface
+
+#endif  // AUTONNIC_WIND_SRC_OUTPUT_NMEA0183_ENCODER_H_
@@ -0,0 +1,234 @@
+#ifndef AUTONNIC_WIND_SRC_OUTPUT_NMEA0183_WIND_OUTPUT_H_
+#define AUTONNIC_WIND_SRC_OUTPUT_NMEA0183_WIND_OUTPUT_H_
+
+#include "imu/mast_motion.h"
+#include "nmea0183_encoder.h"
+#include "rate/adaptive_rate_controller.h"
+#include "sensesp.h"
+#include "sensesp/system/lambda_consumer.h"
+#include "sensesp/system/observablevalue.h"
+#include "sensesp/system/saveable.h"
+#include "sensesp/system/serializable.h"
+#include "wind_correction.h"
+#include "wind_sample.h"
+
+namespace wind_interface {
+
+/**
+ * @brief Re-emits processed apparent wind as NMEA 0183 MWV and VWR
+ * sentences on a UART.
+ *
+ * Incoming samples are corrected for upwash and heel and optionally
+ * smoothed. Each sentence type is sent at its own configurable
+ * interval, encoded directly into a fixed buffer. If the UART transmit FIFO
+ * cannot take a whole sentence, the sentence is dropped instead of blocking
+ * the event loop.
+ */
+class NMEA0183WindOutput : public sensesp::FileSystemSaveable,
+                           virtual public sensesp::Serializable {
+ public:
+  /**
+   * @param stream Output stream
+   * @param motion Source of the heel angle, or nullptr for no heel
+   * correction
+   * @param config_path Configuration path
+   */
+  NMEA0183WindOutput(Stream* stream, MotionAccumulator* motion = nullptr,
+                     String config_path = "")
+      : sensesp::FileSystemSaveable(config_path),
+        sensesp::Serializable(),
+        stream_{stream},
+        motion_{motion} {
+    load();
+    sensesp::event_loop()->onRepeat(kTickInterval, [this]() { tick(); });
+  }
+
+  sensesp::LambdaConsumer<WindSample> wind_input_{
+      [this](const WindSample& sample) { add_sample(sample); }};
+
+  /**
+   * @brief Request sensor output at least as often as the sentences are
+   * sent.
+   *
+   * The demand follows the configured sentence intervals and is inactive
+   * while both sentences are disabled.
+   */
+  void set_demand(OutputDemand* demand) {
+    demand_ = demand;
+    update_demand();
+  }
+
+  /// Shortest enabled sentence interval, in ms, or 0 if none is enabled
+  unsigned int get_demand_interval() const {
+    unsigned long interval = mwv_interval_;
+    if (vwr_interval_ > 0 && (interval == 0 || vwr_interval_ < interval)) {
+      interval = vwr_interval_;
+    }
+    return interval;
+  }
+
+  sensesp::ObservableValue<int> sentences_sent_ = 0;
+  sensesp::ObservableValue<int> sentences_dropped_ = 0;
+
+  inline virtual bool to_json(JsonObject& doc) override {
+    doc["mwv_interval"] = mwv_interval_;
+    doc["vwr_interval"] = vwr_interval_;
+    doc["smoothing_time"] = smoothing_time_;
+    JsonArray angle_offsets = doc["angle_offsets"].to<JsonArray>();
+    JsonArray speed_factors = doc["speed_factors"].to<JsonArray>();
+    for (int i = 0; i < WindCorrectionTable::kNumPoints; i++) {
+      angle_offsets.add(correction_.get_angle_offset(i));
+      speed_factors.add(correction_.get_speed_factor(i));
+    }
+    JsonArray heel_angle_offsets = doc["heel_angle_offsets"].to<JsonArray>();
+    JsonArray heel_speed_factors = doc["heel_speed_factors"].to<JsonArray>();
+    for (int j = 0; j < WindCorrectionTable::kNumHeelPoints; j++) {
+      JsonArray offsets = heel_angle_offsets.add<JsonArray>();
+      JsonArray factors = heel_speed_factors.add<JsonArray>();
+      for (int i = 0; i < WindCorrectionTable::kNumPoints; i++) {
+        offsets.add(correction_.get_heel_angle_offset(j, i));
+        factors.add(correction_.get_heel_speed_factor(j, i));
+      }
+    }
+    return true;
+  }
+
+  inline virtual bool from_json(const JsonObject& config) override {
+    String expected_keys[] = {"mwv_interval", "vwr_interval", "smoothing_time",
+                              "angle_offsets", "speed_factors",
+                              "heel_angle_offsets", "heel_speed_factors"};
+    for (auto& key : expected_keys) {
+      if (!config[key].is<JsonVariant>()) {
+        return false;
+      }
+    }
+    mwv_interval_ = config["mwv_interval"];
+    vwr_interval_ = config["vwr_interval"];
+    smoothing_time_ = config["smoothing_time"];
+    JsonArray angle_offsets = config["angle_offsets"];
+    JsonArray speed_factors = config["speed_factors"];
+    for (int i = 0; i < WindCorrectionTable::kNumPoints; i++) {
+      float offset =
+          i < (int)angle_offsets.size() ? angle_offsets[i].as<float>() : 0;
+      float factor =
+          i < (int)speed_factors.size() ? speed_factors[i].as<float>() : 1;
+      correction_.set_point(i, offset, factor);
+    }
+    JsonArray heel_angle_offsets = config["heel_angle_offsets"];
+    JsonArray heel_speed_factors = config["heel_speed_factors"];
+    for (int j = 0; j < WindCorrectionTable::kNumHeelPoints; j++) {
+      // One row per heel angle; missing rows or points leave no residual
+      JsonArray offsets = heel_angle_offsets[j];
+      JsonArray factors = heel_speed_factors[j];
+      for (int i = 0; i < WindCorrectionTable::kNumPoints; i++) {
+        float offset = i < (int)offsets.size() ? offsets[i].as<float>() : 0;
+        float factor = i < (int)factors.size() ? factors[i].as<float>() : 1;
+        correction_.set_heel_point(j, i, offset, factor);
+      }
+    }
+    update_demand();
+    return true;
+  }
+
+ protected:
+  static constexpr unsigned long kTickInterval = 20;
+  // Don't send data older than this, in ms
+  static constexpr unsigned long kMaxAge = 2000;
+
+  void update_demand() {
+    if (demand_ == nullptr) {
+      return;
+    }
+    unsigned int interval = get_demand_interval();
+    demand_->set_interval(interval);
+    demand_->set(interval > 0);
+  }
+
+  void add_sample(const WindSample& sample) {
+    float speed = sample.speed;
+    float angle = sample.angle * (180 / M_PI);
+    float heel = motion_ != nullptr ? motion_->heel() * (180 / M_PI) : 0;
+    correction_.apply(&speed, &angle, heel);
+
+    unsigned long now = millis();
+    if (sample_time_ == 0 || smoothing_time_ <= 0) {
+      speed_ = speed;
+      angle_ = angle;
+    } else {
+      // The weight depends on the time since the previous sample, so the
+      // smoothing does not change with the sensor output rate
+      float dt = (now - sample_time_) / 1000.0f;
+      float alpha = 1 - expf(-dt / smoothing_time_);
+      speed_ += alpha * (speed - speed_);
+      // Take the short way around the circle
+      float d_angle = angle - angle_;
+      if (d_angle > 180) d_angle -= 360;
+      if (d_angle < -180) d_angle += 360;
+      angle_ += alpha * d_angle;
+      if (angle_ < 0) angle_ += 360;
+      if (angle_ >= 360) angle_ -= 360;
+    }
+    sample_time_ = now;
+  }
+
+  void tick() {
+    unsigned long now = millis();
+    bool valid = sample_time_ != 0 && now - sample_time_ < kMaxAge;
+
+    if (mwv_interval_ > 0 && now - mwv_sent_ >= mwv_interval_) {
+      mwv_sent_ = now;
+      send(EncodeMWV(buffer_, speed_, angle_, valid));
+    }
+    if (valid && vwr_interval_ > 0 && now - vwr_sent_ >= vwr_interval_) {
+      vwr_sent_ = now;
+      send(EncodeVWR(buffer_, speed_, angle_));
+    }
+  }
+
+  void send(size_t len) {
+    if (stream_->availableForWrite() < (int)len) {
+      sentences_dropped_ = sentences_dropped_.get() + 1;
+      return;
+    }
+    stream_->write((const uint8_t*)buffer_, len);
+    sentences_sent_ = sentences_sent_.get() + 1;
+  }
+
+  Stream* stream_;
+  MotionAccumulator* motion_;
+  OutputDemand* demand_ = nullptr;
+  char buffer_[NMEA0183SentenceBuilder::kMaxLength];
+
+  unsigned long mwv_interval_ = 500;  // ms, 0 disables the sentence
+  unsigned long vwr_interval_ = 1000;
+  float smoothing_time_ = 0;  // Time constant, in s; 0 disables smoothing
+  WindCorrectionTable correction_;
+
+  unsigned long mwv_sent_ = 0;
+  unsigned long vwr_sent_ = 0;
+
+  // Corrected and smoothed wind. Angle is in degrees.
+  float speed_ = 0;
+  float angle_ = 0;
+  unsigned long sample_time_ = 0;
+};
+
+inline const String ConfigSchema(const NMEA0183WindOutput& obj) {
+  const char schema[] = R"({
+      "type": "object",
+      "properties": {
+        "mwv_interval": { "title": "MWV Interval (ms, 0 to disable)", "type": "integer" },
+        "vwr_interval": { "title": "VWR Interval (ms, 0 to disable)", "type": "integer" },
+        "smoothing_time": { "title": "Smoothing Time Constant (s, 0 to disable)", "type": "number", "minimum": 0 },
+        "angle_offsets": { "title": "Upwash Angle Offsets (deg at 0, 15, ..., 180 deg)", "type": "array", "items": { "type": "number" } },
+        "speed_factors": { "title": "Upwash Speed Factors (at 0, 15, ..., 180 deg)", "type": "array", "items": { "type": "number" } },
+        "heel_angle_offsets": { "title": "Heel Residual Angle Offsets (rows at 0, 5, ..., 30 deg heel; deg at 0, 15, ..., 180 deg)", "type": "array", "items": { "type": "array", "items": { "type": "number" } } },
+        "heel_speed_factors": { "title": "Heel Residual Speed Factors (rows at 0, 5, ..., 30 deg heel; at 0, 15, ..., 180 deg)", "type": "array", "items": { "type": "array", "items": { "type": "number" } } }
+      }
+    })";
+  return schema;
+}
+
+}  // namespace wind_interface
+
+#endif  // AUTONNIC_WIND_SRC_OUTPUT_NMEA0183_WIND_OUTPUT_H_
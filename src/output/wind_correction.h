@@ -0,0 +1,172 @@
+#ifndef AUTONNIC_WIND_SRC_OUTPUT_WIND_CORRECTION_H_
+#define AUTONNIC_WIND_SRC_OUTPUT_WIND_CORRECTION_H_
+
+#include <cmath>
+
+namespace wind_interface {
+
+/**
+ * @brief Upwash and heel correction of apparent wind.
+ *
+ * The sails bend the airflow at the masthead, so the measured angle and
+ * speed are off by an amount that depends on the apparent wind angle. The
+ * correction is given at kNumPoints angles from 0 to 180 degrees and
+ * mirrored for port side winds.
+ *
+ * When heeled, the sensor measures the wind in a tilted plane, which
+ * shortens the cross component by cos(heel). The measured angle is then
+ * atan(tan(awa) * cos(heel)): unchanged at 0, 90 and 180 degrees, too
+ * small when close-hauled and too large when reaching broad. This
+ * geometric error is computed and removed. A second table gives the
+ * residual correction at each apparent wind angle and kNumHeelPoints heel
+ * angles from 0 to kMaxHeel degrees, applied the same way. The heel sign
+ * does not matter, and beyond kMaxHeel the correction for kMaxHeel applies.
+ *
+ * Values between the table points are linearly interpolated, bilinearly in
+ * the heel table.
+ */
+class WindCorrectionTable {
+ public:
+  static constexpr int kNumPoints = 13;
+  static constexpr float kStep = 180.0f / (kNumPoints - 1);  // degrees
+  static constexpr int kNumHeelPoints = 7;
+  static constexpr float kMaxHeel = 30;  // degrees
+  static constexpr float kHeelStep = kMaxHeel / (kNumHeelPoints - 1);
+
+  WindCorrectionTable() {
+    for (int i = 0; i < kNumPoints; i++) {
+      angle_offsets_[i] = 0;
+      speed_factors_[i] = 1;
+      for (int j = 0; j < kNumHeelPoints; j++) {
+        heel_angle_offsets_[j][i] = 0;
+        heel_speed_factors_[j][i] = 1;
+      }
+    }
+  }
+
+  /**
+   * @brief Set a table point.
+   *
+   * @param index Point index; the point is at index * kStep degrees
+   * @param angle_offset Value added to starboard wind angles, in degrees
+   * @param speed_factor Multiplier for the wind speed
+   */
+  void set_point(int index, float angle_offset, float speed_factor) {
+    if (index >= 0 && index < kNumPoints) {
+      angle_offsets_[index] = angle_offset;
+      speed_factors_[index] = speed_factor;
+    }
+  }
+
+  float get_angle_offset(int index) const { return angle_offsets_[index]; }
+  float get_speed_factor(int index) const { return speed_factors_[index]; }
+
+  /**
+   * @brief Set a heel residual table point.
+   *
+   * @param heel_index Heel index; the point is at heel_index * kHeelStep
+   * degrees of heel
+   * @param index Wind angle index; the point is at index * kStep degrees
+   * @param angle_offset Value added to starboard wind angles, in degrees
+   * @param speed_factor Multiplier for the wind speed
+   */
+  void set_heel_point(int heel_index, int index, float angle_offset,
+                      float speed_factor) {
+    if (heel_index >= 0 && heel_index < kNumHeelPoints && index >= 0 &&
+        index < kNumPoints) {
+      heel_angle_offsets_[heel_index][index] = angle_offset;
+      heel_speed_factors_[heel_index][index] = speed_factor;
+    }
+  }
+
+  float get_heel_angle_offset(int heel_index, int index) const {
+    return heel_angle_offsets_[heel_index][index];
+  }
+  float get_heel_speed_factor(int heel_index, int index) const {
+    return heel_speed_factors_[heel_index][index];
+  }
+
+  /**
+   * @brief Correct a sample.
+   *
+   * @param speed Wind speed; corrected in place
+   * @param angle Wind angle in degrees, 0 to 360; corrected in place
+   * @param heel Heel angle in degrees, either sign
+   */
+  void apply(float* speed, float* angle, float heel = 0) const {
+    bool port = *angle > 180;
+    float side_angle = port ? 360 - *angle : *angle;
+
+    int index;
+    float fraction;
+    locate(side_angle / kStep, kNumPoints, &index, &fraction);
+    float offset = lerp(angle_offsets_[index], angle_offsets_[index + 1],
+                        fraction);
+    float factor = lerp(speed_factors_[index], speed_factors_[index + 1],
+                        fraction);
+
+    heel = fminf(fabsf(heel), kMaxHeel);
+    if (heel > 0) {
+      // Undo the shortening of the cross component
+      float side_rad = side_angle * (float)(M_PI / 180);
+      float along = cosf(side_rad);
+      float across = sinf(side_rad) / cosf(heel * (float)(M_PI / 180));
+      offset += atan2f(across, along) * (float)(180 / M_PI) - side_angle;
+      factor *= sqrtf(along * along + across * across);
+    }
+
+    int heel_index;
+    float heel_fraction;
+    locate(heel / kHeelStep, kNumHeelPoints, &heel_index, &heel_fraction);
+    offset += bilerp(heel_angle_offsets_, heel_index, heel_fraction, index,
+                     fraction);
+    factor *= bilerp(heel_speed_factors_, heel_index, heel_fraction, index,
+                     fraction);
+
+    float corrected = port ? *angle - offset : *angle + offset;
+    if (corrected < 0) {
+      corrected += 360;
+    } else if (corrected >= 360) {
+      corrected -= 360;
+    }
+    *angle = corrected;
+    *speed *= factor;
+  }
+
+ protected:
+  /// Split a table position into a segment index and fraction, clamped to
+  /// the table
+  static void locate(float position, int num_points, int* index,
+                     float* fraction) {
+    if (position >= num_points - 1) {
+      *index = num_points - 2;
+      *fraction = 1;
+      return;
+    }
+    *index = (int)position;
+    *fraction = position - *index;
+  }
+
+  static float lerp(float a, float b, float fraction) {
+    return a + fraction * (b - a);
+  }
+
+  static float bilerp(const float table[][kNumPoints], int row,
+                      float row_fraction, int column, float column_fraction) {
+    float low = lerp(table[row][column], table[row][column + 1],
+                     column_fraction);
+    float high = lerp(table[row + 1][column], table[row + 1][column + 1],
+                      column_fraction);
+    return lerp(low, high, row_fraction);
+  }
+
+  float angle_offsets_[kNumPoints];
+  float speed_factors_[kNumPoints];
+  // Residual heel correction, indexed by heel and then wind angle
+  float heel_angle_offsets_[kNumHeelPoints][kNumPoints];
+  float heel_speed_factors_[kNumHeelPoints][kNumPoints];
+};
+
+}  // namespace wind_interface
+
+#endif  // AUTONNIC_WIND_SRC_OUTPUT_WIND_CORRECTION_H_
@@ -0,0 +1,240 @@
+#ifndef AUTONNIC_WIND_SRC_RATE_ADAPTIVE_RATE_CONTROLLER_H_
+#define AUTONNIC_WIND_SRC_RATE_ADAPTIVE_RATE_CONTROLLER_H_
+
+#include <vector>
+
+#include "autonnic_a5120_parser.h"
+#include "autonnic_config.h"
+#include "output_rate_policy.h"
+#include "sensesp.h"
+#include "sensesp/system/lambda_consumer.h"
+#include "sensesp/system/observablevalue.h"
+#include "sensesp/system/saveable.h"
+#include "sensesp/system/serializable.h"
+#include "sensesp/system/valueconsumer.h"
+#include "sensesp/system/valueproducer.h"
+#include "sensesp_nmea0183/nmea0183.h"
+#include "wind_sample.h"
+
+namespace wind_interface {
+
+/**
+ * @brief Output rate requested by a wind data consumer.
+ *
+ * The demand is active while the connected count, e.g. the number of
+ * network clients, is greater than zero. Outputs without a client count
+ * set 1 while something is listening, e.g. while the Signal K server is
+ * connected.
+ */
+class OutputDemand : public sensesp::ValueConsumer<int> {
+ public:
+  /// @param interval Shortest output interval useful to the consumer, in ms
+  OutputDemand(unsigned int interval) : interval_{interval} {}
+
+  virtual void set(const int& count) override { active_ = count > 0; }
+
+  bool is_active() const { return active_; }
+  unsigned int get_interval() const { return interval_; }
+  void set_interval(unsigned int interval) { interval_ = interval; }
+
+ protected:
+  unsigned int interval_;
+  bool active_ = false;
+};
+
+/**
+ * @brief Adjusts the A5120 output interval to the wind conditions.
+ *
+ * The variability of the received wind and the demand of the active
+ * outputs are evaluated once per second by OutputRatePolicy. Interval
+ * changes are sent as PATC TXP commands without waiting for the response.
+ * The response parser matches the response to the TXP command, so answers
+ * to other commands on the same link are not mistaken for it. A NAK or a
+ * missing acknowledgement is retried on later evaluations.
+ *
+ * When enabled, the controller overrides the static Message Repetition
+ * Rate setting. The acknowledged interval is emitted.
+ */
+class AdaptiveRateController : public sensesp::FileSystemSaveable,
+                               virtual public sensesp::Serializable,
+                               public sensesp::ValueProducer<int> {
+ public:
+  AdaptiveRateController(sensesp::nmea0183::NMEA0183IOTask* nmea_io_task,
+                         AutonnicPATCWIMWVParser* response_parser,
+                         bool enabled, String config_path = "")
+      : sensesp::FileSystemSaveable(config_path),
+        sensesp::Serializable(),
+        nmea_io_task_{nmea_io_task},
+        response_parser_{response_parser},
+        enabled_{enabled} {
+    load();
+    policy_.set_limits(min_interval_, max_interval_);
+    response_parser->connect_to(&response_consumer_);
+    sensesp::event_loop()->onRepeat(kEvaluationInterval,
+                                    [this]() { evaluate(); });
+    sensesp::event_loop()->onRepeat(kSampleRateInterval,
+                                    [this]() { update_sample_rate(); });
+  }
+
+  sensesp::LambdaConsumer<WindSample> wind_input_{
+      [this](const WindSample& sample) {
+        variability_estimator_.add(millis(), sample.speed, sample.angle);
+        sample_count_++;
+      }};
+
+  /// Register a consumer of the wind data
+  OutputDemand* add_demand(unsigned int interval) {
+    OutputDemand* demand = new OutputDemand(interval);
+    demands_.push_back(demand);
+    return demand;
+  }
+
+  /// Acknowledged output interval, in ms, or 0 if not yet known
+  sensesp::ObservableValue<int> output_interval_ = 0;
+  /// Number of acknowledged interval changes
+  sensesp::ObservableValue<int> rate_changes_ = 0;
+  /// Measured wind sample rate, in Hz
+  sensesp::ObservableValue<float> sample_rate_ = 0;
+  /// Current WindVariability score
+  sensesp::ObservableValue<float> variability_ = 0;
+
+  inline virtual bool to_json(JsonObject& doc) override {
+    doc["enabled"] = enabled_;
+    doc["min_interval"] = min_interval_;
+    doc["max_interval"] = max_interval_;
+    return true;
+  }
+
+  inline virtual bool from_json(const JsonObject& config) override {
+    String expected_keys[] = {"enabled", "min_interval", "max_interval"};
+    for (auto& key : expected_keys) {
+      if (!config[key].is<JsonVariant>()) {
+        return false;
+      }
+    }
+    enabled_ = config["enabled"];
+    min_interval_ = config["min_interval"];
+    max_interval_ = config["max_interval"];
+    policy_.set_limits(min_interval_, max_interval_);
+    return true;
+  }
+
+ protected:
+  static constexpr unsigned long kEvaluationInterval = 1000;
+  static constexpr unsigned long kSampleRateInterval = 5000;
+  // Time to wait for the TXP acknowledgement, in ms
+  static constexpr uint32_t kAckTimeout = 1000;
+  // After this many unacknowledged commands, slow down the retries
+  static constexpr int kMaxAttempts = 3;
+  static constexpr uint32_t kRetryInterval = 30000;
+
+  unsigned int demand_interval() const {
+    unsigned int interval = 0;
+    for (auto demand : demands_) {
+      if (demand->is_active() &&
+          (interval == 0 || demand->get_interval() < interval)) {
+        interval = demand->get_interval();
+      }
+    }
+    return interval;
+  }
+
+  void evaluate() {
+    float score = variability_estimator_.score();
+    variability_ = score;
+    if (!enabled_) {
+      return;
+    }
+    uint32_t now = millis();
+    policy_.update(now, score, demand_interval());
+
+    if (pending_interval_ != 0) {
+      if (now - sent_ms_ < kAckTimeout) {
+        return;
+      }
+      ESP_LOGW("AdaptiveRateController", "TXP %d not acknowledged",
+               pending_interval_);
+      pending_interval_ = 0;
+      failures_++;
+    }
+
+    unsigned int target = policy_.interval();
+    if ((int)target == output_interval_.get()) {
+      failures_ = 0;
+      return;
+    }
+    if (failures_ >= kMaxAttempts && now - sent_ms_ < kRetryInterval) {
+      return;
+    }
+
+    ESP_LOGD("AdaptiveRateController", "Setting output interval to %d ms",
+             target);
+    pending_interval_ = target;
+    sent_ms_ = now;
+    pending_command_ = response_parser_->send_command(
+        nmea_io_task_, AutonnicMessageRepetitionRateSentence(target));
+  }
+
+  void update_sample_rate() {
+    uint32_t now = millis();
+    if (sample_rate_ms_ != 0) {
+      sample_rate_ = sample_count_ * 1000.0f / (now - sample_rate_ms_);
+    }
+    sample_rate_ms_ = now;
+    sample_count_ = 0;
+  }
+
+  sensesp::LambdaConsumer<bool> response_consumer_{[this](bool ok) {
+    if (pending_interval_ == 0 ||
+        response_parser_->answered_command() != pending_command_) {
+      return;
+    }
+    if (!response_parser_->is_ack()) {
+      ESP_LOGW("AdaptiveRateController", "TXP %d rejected",
+               pending_interval_);
+      pending_interval_ = 0;
+      failures_++;
+      return;
+    }
+    output_interval_ = pending_interval_;
+    rate_changes_ = rate_changes_.get() + 1;
+    pending_interval_ = 0;
+    failures_ = 0;
+    this->emit(output_interval_.get());
+  }};
+
+  sensesp::nmea0183::NMEA0183IOTask* nmea_io_task_;
+  AutonnicPATCWIMWVParser* response_parser_;
+  bool enabled_;
+  unsigned int min_interval_ =
+      OutputRatePolicy::kLevels[OutputRatePolicy::kNumLevels - 1];
+  unsigned int max_interval_ = OutputRatePolicy::kLevels[0];
+
+  WindVariability variability_estimator_;
+  OutputRatePolicy policy_;
+  std::vector<OutputDemand*> demands_;
+
+  int pending_interval_ = 0;  // Sent but not yet acknowledged
+  uint32_t pending_command_ = 0;
+  uint32_t sent_ms_ = 0;
+  int failures_ = 0;
+
+  int sample_count_ = 0;
+  uint32_t sample_rate_ms_ = 0;
+};
+
+inline const String ConfigSchema(const AdaptiveRateController& obj) {
+  const char schema[] = R"({
+      "type": "object",
+      "properties": {
+        "enabled": { "title": "Enabled", "type": "boolean" },
+        "min_interval": { "title": "Shortest Interval (ms)", "type": "integer" },
+        "max_interval": { "title": "Longest Interval (ms)", "type": "integer" }
+      }
+    })";
+  return schema;
+}
+
+}  // namespace wind_interface
+
+#endif  // AUTONNIC_WIND_SRC_RATE_ADAPTIVE_RATE_CONTROLLER_H_
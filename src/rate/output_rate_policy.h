@@ -0,0 +1,205 @@
+#ifndef AUTONNIC_WIND_SRC_RATE_OUTPUT_RATE_POLICY_H_
+#define AUTONNIC_WIND_SRC_RATE_OUTPUT_RATE_POLICY_H_
+
+#include <cmath>
+#include <cstdint>
+
+namespace wind_interface {
+
+/**
+ * @brief Estimates how much the apparent wind is changing.
+ *
+ * Tracks exponentially weighted means and variances of wind speed and
+ * angle. The weights depend on the time between samples, so the estimate
+ * does not change with the sensor output rate.
+ */
+class WindVariability {
+ public:
+  // Standard deviations that correspond to a score of 1
+  static constexpr float kAngleReference = 5 * M_PI / 180;  // rad
+  static constexpr float kSpeedReference = 0.1;  // Relative to the mean
+  // Below this mean speed, the wind angle is too noisy to be meaningful
+  static constexpr float kMinSpeed = 1.0;  // m/s
+
+  /// @param time_constant Averaging time constant, in seconds
+  explicit WindVariability(float time_constant = 10)
+      : time_constant_{time_constant} {}
+
+  /**
+   * @brief Add a sample.
+   *
+   * @param time_ms Sample time, in milliseconds
+   * @param speed Wind speed, in m/s
+   * @param angle Wind angle, in radians
+   */
+  void add(uint32_t time_ms, float speed, float angle) {
+    if (!initialized_) {
+      speed_mean_ = speed;
+      angle_mean_ = angle;
+      time_ms_ = time_ms;
+      initialized_ = true;
+      return;
+    }
+    float dt = (uint32_t)(time_ms - time_ms_) / 1000.0f;
+    time_ms_ = time_ms;
+    float alpha = 1 - expf(-dt / time_constant_);
+
+    float d_speed = speed - speed_mean_;
+    speed_mean_ += alpha * d_speed;
+    speed_var_ += alpha * (d_speed * d_speed - speed_var_);
+
+    // Take the short way around the circle
+    float d_angle = remainderf(angle - angle_mean_, 2 * M_PI);
+    angle_mean_ = remainderf(angle_mean_ + alpha * d_angle, 2 * M_PI);
+    angle_var_ += alpha * (d_angle * d_angle - angle_var_);
+  }
+
+  /**
+   * @brief Variability score. Values above 1 indicate shifting or gusty
+   * wind.
+   */
+  float score() const {
+    float mean = speed_mean_ > kMinSpeed ? speed_mean_ : kMinSpeed;
+    float speed_score = sqrtf(speed_var_) / mean / kSpeedReference;
+    if (speed_mean_ < kMinSpeed) {
+      return speed_score;
+    }
+    float angle_score = sqrtf(angle_var_) / kAngleReference;
+    return angle_score > speed_score ? angle_score : speed_score;
+  }
+
+ protected:
+  float time_constant_;
+  bool initialized_ = false;
+  uint32_t time_ms_ = 0;
+  float speed_mean_ = 0;
+  float speed_var_ = 0;
+  float angle_mean_ = 0;
+  float angle_var_ = 0;
+};
+
+/**
+ * @brief Selects the wind sensor output interval.
+ *
+ * The interval is one of a fixed set of levels. It is shortened one level
+ * at a time when the variability score stays high, and lengthened one
+ * level at a time when it stays low. Separate thresholds, hold times and a
+ * minimum dwell time between changes prevent oscillation. The interval is
+ * never shorter than the fastest interval requested by the active outputs;
+ * with no active outputs, the slowest level is used.
+ */
+class OutputRatePolicy {
+ public:
+  static constexpr unsigned int kLevels[] = {1000, 500, 250, 125};  // ms
+  static constexpr int kNumLevels = sizeof(kLevels) / sizeof(kLevels[0]);
+
+  static constexpr float kUpThreshold = 1.0;
+  static constexpr float kDownThreshold = 0.4;
+  // Time the score has to stay beyond a threshold, in ms
+  static constexpr uint32_t kUpHoldTime = 2000;
+  static constexpr uint32_t kDownHoldTime = 30000;
+  // Minimum time between variability driven changes, in ms
+  static constexpr uint32_t kMinDwellTime = 10000;
+
+  /**
+   * @param min_interval Shortest allowed interval, in ms
+   * @param max_interval Longest allowed interval, in ms
+   * @param initial_interval Interval to start from, in ms
+   */
+  OutputRatePolicy(unsigned int min_interval = kLevels[kNumLevels - 1],
+                   unsigned int max_interval = kLevels[0],
+                   unsigned int initial_interval = 500) {
+    level_ = level_for(initial_interval);
+    set_limits(min_interval, max_interval);
+  }
+
+  void set_limits(unsigned int min_interval, unsigned int max_interval) {
+    // Fastest level not shorter than min_interval
+    max_level_ = 0;
+    while (max_level_ < kNumLevels - 1 &&
+           kLevels[max_level_ + 1] >= min_interval) {
+      max_level_++;
+    }
+    // Slowest level not longer than max_interval
+    min_level_ = 0;
+    while (min_level_ < max_level_ && kLevels[min_level_] > max_interval) {
+      min_level_++;
+    }
+    level_ = clamp(level_, min_level_, max_level_);
+  }
+
+  /**
+   * @brief Evaluate the policy.
+   *
+   * @param now_ms Current time, in milliseconds
+   * @param score Current WindVariability::score()
+   * @param demand_interval Shortest interval requested by the active
+   * outputs, in ms, or 0 if no output is active
+   * @return true if the interval changed
+   */
+  bool update(uint32_t now_ms, float score, unsigned int demand_interval) {
+    int demand_level =
+        demand_interval == 0 ? min_level_ : level_for(demand_interval);
+    int ceiling = clamp(demand_level, min_level_, max_level_);
+
+    bool high = score > kUpThreshold;
+    bool low = score < kDownThreshold;
+    if ((high && !high_) || (low && !low_)) {
+      since_ms_ = now_ms;
+    }
+    high_ = high;
+    low_ = low;
+
+    int level = level_;
+    if (level > ceiling) {
+      // Demand changes are discrete events; follow them immediately
+      level = ceiling;
+    } else if (!changed_ || now_ms - changed_ms_ >= kMinDwellTime) {
+      if (high_ && now_ms - since_ms_ >= kUpHoldTime && level < ceiling) {
+        level++;
+      } else if (low_ && now_ms - since_ms_ >= kDownHoldTime &&
+                 level > min_level_) {
+        level--;
+      }
+    }
+    if (level == level_) {
+      return false;
+    }
+    level_ = level;
+    changed_ = true;
+    changed_ms_ = now_ms;
+    since_ms_ = now_ms;
+    return true;
+  }
+
+  /// Current output interval, in ms
+  unsigned int interval() const { return kLevels[level_]; }
+
+ protected:
+  /// Slowest level that is at least as fast as interval
+  static int level_for(unsigned int interval) {
+    int level = 0;
+    while (level < kNumLevels - 1 && kLevels[level] > interval) {
+      level++;
+    }
+    return level;
+  }
+
+  static int clamp(int value, int low, int high) {
+    return value < low ? low : (value > high ? high : value);
+  }
+
+  int level_ = 0;
+  int min_level_ = 0;  // Slowest allowed level
+  int max_level_ = 0;  // Fastest allowed level
+
+  bool high_ = false;
+  bool low_ = false;
+  uint32_t since_ms_ = 0;  // Start of the current high or low period
+  bool changed_ = false;
+  uint32_t changed_ms_ = 0;
+};
+
+}  // namespace wind_interface
+
+#endif  // AUTONNIC_WIND_SRC_RATE_OUTPUT_RATE_POLICY_H_
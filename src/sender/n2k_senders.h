@@ -5,12 +5,14 @@
 #include <NMEA2000.h>
 
 #include <tuple>
+#include <utility>
 
 #include "sensesp/system/expiring_value.h"
 #include "sensesp/system/lambda_consumer.h"
 #include "sensesp/system/saveable.h"
 #include "sensesp/system/serializable.h"
-#include "sensesp/transforms/repeat.h"
+#include "sensesp/system/valueconsumer.h"
+#include "sensesp/system/valueproducer.h"
 
 namespace wind_interface {
 
@@ -36,47 +38,194 @@ class N2kSender : public sensesp::Saveable, public sensesp::Serializable {
   reactesp::RepeatEvent* sender_event_ = nullptr;
 };
 
-class N2kWindDataSender
-    : public N2kSender,
-      public sensesp::ValueProducer<std::pair<double, double>> {
+/**
+ * @brief Value used for a field input that has not been updated recently.
+ *
+ * Specialize for any new field type used with N2kCachedSender.
+ */
+template <typename T>
+struct N2kNotAvailable;
+
+template <>
+struct N2kNotAvailable<double> {
+  static constexpr double value() { return N2kDoubleNA; }
+};
+
+/**
+ * @brief Byte offset of the sequence identifier (SID) in the PGN payload,
+ * or -1 if the PGN has no SID.
+ *
+ * Every PGN used with N2kCachedSender must have a specialization so that
+ * the cached message can be patched in place.
+ */
+template <unsigned long PGN>
+struct N2kSidOffset;
+
+// Wind Data
+template <>
+struct N2kSidOffset<130306> {
+  static constexpr int value = 0;
+};
+
+// Environmental Parameters
+template <>
+struct N2kSidOffset<130311> {
+  static constexpr int value = 0;
+};
+
+// Meteorological Station Data
+template <>
+struct N2kSidOffset<130323> {
+  static constexpr int value = -1;
+};
+
+/**
+ * @brief Input for a single PGN field. Stores the latest value and reverts
+ * to "not available" if no new value arrives within the expiry time.
+ *
+ * Unlike RepeatExpiring, the input is passive: the owning sender polls it
+ * once per transmission, so no additional events are created per field.
+ */
+template <typename T>
+class N2kFieldInput : public sensesp::ValueConsumer<T> {
  public:
-  N2kWindDataSender(String config_path, tN2kWindReference wind_reference,
-                    tNMEA2000* nmea2000, bool enable = true)
+  N2kFieldInput(unsigned long expiry)
+      : value_{N2kNotAvailable<T>::value(), expiry,
+               N2kNotAvailable<T>::value()} {}
+
+  virtual void set(const T& new_value) override { value_.update(new_value); }
+
+  T get() { return value_.get(); }
+
+ protected:
+  sensesp::ExpiringValue<T> value_;
+};
+
+/**
+ * @brief NMEA 2000 sender that keeps a pre-encoded message and re-packs it
+ * only when one of the input fields changes.
+ *
+ * On every repeat interval, all field inputs are read exactly once. If the
+ * values equal those of the previous transmission, only the SID byte of the
+ * cached message is updated before sending it again.
+ *
+ * Subclasses implement encode() using the matching SetN2k* function. The
+ * sender emits the transmitted field values after each successful send.
+ *
+ * @tparam PGN Parameter group number of the transmitted message
+ * @tparam Fields Types of the encoded fields, in encode() argument order
+ */
+template <unsigned long PGN, typename... Fields>
+class N2kCachedSender : public N2kSender,
+                        public sensesp::ValueProducer<std::tuple<Fields...>> {
+ public:
+  using FieldTuple = std::tuple<Fields...>;
+
+  static constexpr unsigned long kPGN = PGN;
+
+  N2kCachedSender(String config_path, tNMEA2000* nmea2000,
+                  unsigned int repeat_interval, unsigned int expiry,
+                  int device_index = 0)
       : N2kSender{config_path},
-        wind_reference_{wind_reference},
         nmea2000_{nmea2000},
-        repeat_interval_{100},  // In ms. Dictated by NMEA 2000 standard!
-        expiry_{5000}           // In ms. When the inputs expire.
-  {
-    if (enable) {
-      this->enable();
-    }
-  }
+        repeat_interval_{repeat_interval},
+        expiry_{expiry},
+        device_index_{device_index},
+        inputs_{((void)sizeof(Fields), expiry)...} {}
 
   void enable() override {
     if (this->sender_event_ == nullptr) {
-      this->sender_event_ =
-          sensesp::event_loop()->onRepeat(repeat_interval_, [this]() {
-            tN2kMsg N2kMsg;
-            // At the moment, the PGN is sent regardless of whether all the
-            // values are invalid or not.
-            SetN2kWindSpeed(N2kMsg, 255, this->wind_speed_.get(),
-                            this->wind_angle_.get(), this->wind_reference_);
-            this->nmea2000_->SendMsg(N2kMsg);
-            std::pair<double, double> wind_data = std::make_pair(
-                this->wind_speed_.get(), this->wind_angle_.get());
-            this->emit(wind_data);
-          });
+      this->sender_event_ = sensesp::event_loop()->onRepeat(
+          repeat_interval_, [this]() { this->send(); });
     }
   }
 
-  sensesp::RepeatExpiring<double> wind_angle_{repeat_interval_, expiry_};
-  sensesp::RepeatExpiring<double> wind_speed_{repeat_interval_, expiry_};
+  /// Input for the I'th field
+  template <std::size_t I>
+  N2kFieldInput<typename std::tuple_element<I, FieldTuple>::type>& input() {
+    return std::get<I>(inputs_);
+  }
+
+  /// Number of times the message has been re-encoded
+  unsigned long get_encode_count() const { return encode_count_; }
 
  protected:
+  virtual void encode(tN2kMsg& msg, unsigned char sid,
+                      const FieldTuple& fields) = 0;
+
+  void send() {
+    FieldTuple fields = read_inputs(std::index_sequence_for<Fields...>{});
+    unsigned char sid = next_sid();
+
+    constexpr int sid_offset = N2kSidOffset<PGN>::value;
+    if (!msg_valid_ || fields != cached_fields_) {
+      encode(msg_, sid, fields);
+      cached_fields_ = fields;
+      msg_valid_ = true;
+      encode_count_++;
+    } else if (sid_offset >= 0) {
+      msg_.Data[sid_offset] = sid;
+    }
+
+    if (nmea2000_->SendMsg(msg_, device_index_)) {
+      this->emit(fields);
+    }
+  }
+
+  unsigned char next_sid() {
+    // SIDs 253-255 are reserved; 255 means "not available".
+    unsigned char sid = sid_;
+    sid_ = (sid_ + 1) % 253;
+    return sid;
+  }
+
+  template <std::size_t... I>
+  FieldTuple read_inputs(std::index_sequence<I...>) {
+    return FieldTuple{std::get<I>(inputs_).get()...};
+  }
+
+  tNMEA2000* nmea2000_;
   unsigned int repeat_interval_;
   unsigned int expiry_;
-  tNMEA2000* nmea2000_;
+  int device_index_;
+
+  std::tuple<N2kFieldInput<Fields>...> inputs_;
+
+  tN2kMsg msg_;
+  FieldTuple cached_fields_;
+  bool msg_valid_ = false;
+  unsigned char sid_ = 0;
+  unsigned long encode_count_ = 0;
+};
+
+class N2kWindDataSender : public N2kCachedSender<130306, double, double> {
+ public:
+  N2kWindDataSender(String config_path, tN2kWindReference wind_reference,
+                    tNMEA2000* nmea2000, bool enable = true,
+                    int device_index = 0)
+      : N2kCachedSender{config_path, nmea2000,
+                        100,   // In ms. Dictated by NMEA 2000 standard!
+                        5000,  // In ms. When the inputs expire.
+                        device_index},
+        wind_speed_{input<0>()},
+        wind_angle_{input<1>()},
+        wind_reference_{wind_reference} {
+    if (enable) {
+      this->enable();
+    }
+  }
+
+  N2kFieldInput<double>& wind_speed_;
+  N2kFieldInput<double>& wind_angle_;
+
+ protected:
+  void encode(tN2kMsg& msg, unsigned char sid,
+              const FieldTuple& fields) override {
+    // At the moment, the PGN is sent regardless of whether all the
+    // values are invalid or not.
+    SetN2kWindSpeed(msg, sid, std::get<0>(fields), std::get<1>(fields),
+                    wind_reference_);
+  }
 
   tN2kWindReference wind_reference_;
 };
@@ -0,0 +1,274 @@
+#ifndef AUTONNIC_WIND_SRC_WIND_INSTRUMENT_H_
+#define AUTONNIC_WIND_SRC_WIND_INSTRUMENT_H_
+
+#include "autonnic_a5120_parser.h"
+#include "autonnic_config.h"
+#include "health_supervisor.h"
+#include "imu/mast_motion_compensator.h"
+#include "rate/adaptive_rate_controller.h"
+#include "sender/n2k_senders.h"
+#include "sensesp.h"
+#include "sensesp/signalk/signalk_output.h"
+#include "sensesp/system/lambda_consumer.h"
+#include "sensesp/system/observablevalue.h"
+#include "sensesp/ui/config_item.h"
+#include "sensesp_nmea0183/data/wind_data.h"
+#include "sensesp_nmea0183/sentence_parser/wind_sentence_parser.h"
+#include "sensesp_nmea0183/wiring.h"
+#include "wind_sample.h"
+
+namespace wind_interface {
+
+/**
+ * @brief Settings that differ between wind instrument instances.
+ */
+struct WindInstrumentSettings {
+  // Human readable name, used as a prefix for UI titles
+  String name;
+  // Prefix for the configuration paths, e.g. "/Wind"
+  String config_path;
+  // Prefix for the Signal K output configuration paths, e.g. "/SK Path"
+  String sk_config_path;
+  // Default Signal K paths
+  String sk_speed_path;
+  String sk_angle_path;
+
+  HardwareSerial* serial;
+  unsigned long baud_rate;
+  int8_t rx_pin;
+  int8_t tx_pin;
+
+  // NMEA 2000 device index used for transmitting the wind data
+  int n2k_device_index;
+  // Default wind sensor height above the waterline, in meters
+  float mast_height;
+  // Base value for the UI sort order of the configuration items
+  int sort_order;
+};
+
+/**
+ * @brief Complete processing pipeline for a single A5120 wind sensor on its
+ * own UART.
+ *
+ * Each instance owns its NMEA 0183 I/O task, parsers, sensor configuration,
+ * motion compensator, NMEA 2000 sender and Signal K outputs. All instances
+ * share one tNMEA2000 object, the IMU motion accumulator and the health
+ * supervisor; each instance transmits as its own NMEA 2000 device so that
+ * receivers can tell the sensors apart.
+ *
+ * The heap used by an instance and the mean time spent processing each
+ * received wind sample are measured and exposed so that the per-instance
+ * cost can be tracked as sensors are added.
+ */
+class WindInstrument {
+ public:
+  WindInstrument(const WindInstrumentSettings& settings, tNMEA2000* nmea2000,
+                 MotionAccumulator* motion, HealthSupervisor* supervisor)
+      : name_{settings.name} {
+    uint32_t free_heap_before = ESP.getFreeHeap();
+
+    settings.serial->begin(settings.baud_rate, SERIAL_8N1, settings.rx_pin,
+                           settings.tx_pin);
+
+    nmea0183_io_task_ = new sensesp::nmea0183::NMEA0183IOTask(settings.serial);
+
+    raw_wind_data_ = new sensesp::nmea0183::ApparentWindData();
+
+    ConnectApparentWind(&(nmea0183_io_task_->parser_), raw_wind_data_);
+    raw_wind_samples_ = new WindSampleJoiner(raw_wind_data_);
+
+    // All processing of a sample runs synchronously within one dispatch
+    // from the timing consumer
+    raw_wind_samples_->connect_to(&processing_timer_);
+
+    mast_motion_compensator_ = new MastMotionCompensator(
+        motion, settings.mast_height, false,
+        settings.config_path + "/Motion Compensation");
+
+    timed_wind_samples_.connect_to(&(mast_motion_compensator_->wind_input_));
+
+    sensesp::ConfigItem(mast_motion_compensator_)
+        ->set_title(title("Motion Compensation"))
+        ->set_description(
+            "Remove the wind induced by masthead pitch and roll motion, as "
+            "measured by the IMU. Mast height is the height of the wind "
+            "sensor above the waterline, which approximates the center of "
+            "rotation, in meters.")
+        ->set_sort_order(settings.sort_order + 400);
+
+    wind_data_ = &(mast_motion_compensator_->wind_data_);
+    wind_samples_ = new WindSampleJoiner(wind_data_);
+
+    // Connect the response parser
+    response_parser_ =
+        new AutonnicPATCWIMWVParser(&(nmea0183_io_task_->parser_));
+
+    reference_angle_config_ =
+        new ReferenceAngleConfig(nmea0183_io_task_, 0, response_parser_,
+                                 settings.config_path + "/Reference Angle");
+
+    sensesp::ConfigItem(reference_angle_config_)
+        ->set_title(title("Reference Angle"))
+        ->set_description(
+            "Reference angle offset for wind data (in degrees). "
+            "Enter the angle readout when the wind vane is pointing "
+            "straight ahead.")
+        ->set_sort_order(settings.sort_order + 100);
+
+    wind_direction_damping_config_ = new WindDirectionDampingConfig(
+        nmea0183_io_task_, 50.0, response_parser_,
+        settings.config_path + "/Direction Damping");
+
+    sensesp::ConfigItem(wind_direction_damping_config_)
+        ->set_title(title("Wind Direction Damping"))
+        ->set_description(
+            "Wind direction damping factor (0-100.0). Default is "
+            "50.0.")
+        ->set_sort_order(settings.sort_order + 200);
+
+    wind_speed_damping_config_ = new WindSpeedDampingConfig(
+        nmea0183_io_task_, 50.0, response_parser_,
+        settings.config_path + "/Speed Damping");
+
+    sensesp::ConfigItem(wind_speed_damping_config_)
+        ->set_title(title("Wind Speed Damping"))
+        ->set_description(
+            "Wind speed damping factor (0-100.0). Default is 50.0.")
+        ->set_sort_order(settings.sort_order + 300);
+
+    wind_output_repetition_rate_config_ = new WindOutputRepetitionRateConfig(
+        nmea0183_io_task_, 500, response_parser_,
+        settings.config_path + "/Message Repetition Rate");
+
+    sensesp::ConfigItem(wind_output_repetition_rate_config_)
+        ->set_title(title("Message Repetition Rate"))
+        ->set_description(
+            "Wind message repetition rate in milliseconds. Default "
+            "is 500.")
+        ->set_sort_order(settings.sort_order);
+
+    rate_controller_ =
+        new AdaptiveRateController(nmea0183_io_task_, response_parser_, false,
+                                   settings.config_path + "/Adaptive Rate");
+
+    sensesp::ConfigItem(rate_controller_)
+        ->set_title(title("Adaptive Repetition Rate"))
+        ->set_description(
+            "Adjust the wind message repetition rate to the wind conditions: "
+            "faster when the wind is shifting or gusty, slower when it is "
+            "steady. Overrides the static Message Repetition Rate when "
+            "enabled.")
+        ->set_sort_order(settings.sort_order + 50);
+
+    timed_wind_samples_.connect_to(&(rate_controller_->wind_input_));
+
+    // NMEA 2000 output
+
+    wind_data_sender_ = new N2kWindDataSender(
+        settings.config_path + "/NMEA2000", tN2kWindReference::N2kWind_Apparent,
+        nmea2000, true, settings.n2k_device_index);
+
+    wind_data_->speed.connect_to(&(wind_data_sender_->wind_speed_));
+    wind_data_->angle.connect_to(&(wind_data_sender_->wind_angle_));
+
+    // Signal K output
+
+    auto apparent_wind_speed_sk_output = new sensesp::SKOutputFloat(
+        settings.sk_config_path + "/Apparent Wind Speed",
+        settings.sk_speed_path,
+        new sensesp::SKMetadata("Apparent Wind Speed", "m/s"));
+
+    auto apparent_wind_angle_sk_output = new sensesp::SKOutputFloat(
+        settings.sk_config_path + "/Apparent Wind Angle",
+        settings.sk_angle_path,
+        new sensesp::SKMetadata("Apparent Wind Angle", "rad"));
+
+    wind_data_->speed.connect_to(apparent_wind_speed_sk_output);
+    wind_data_->angle.connect_to(apparent_wind_angle_sk_output);
+
+    // Link supervision
+
+    serial_link_ = supervisor->add_link(new SerialLink(
+        title("Wind Sensor"), settings.serial, settings.baud_rate,
+        kWindTimeout));
+
+    raw_wind_data_->speed.connect_to(new sensesp::LambdaConsumer<float>(
+        [this](float) { serial_link_->feed(); }));
+
+    // Allow a few missed sentences at slow output rates
+    rate_controller_->connect_to(new sensesp::LambdaConsumer<int>(
+        [this](int interval) {
+          unsigned long timeout = 4 * interval;
+          serial_link_->set_timeout(timeout > kWindTimeout ? timeout
+                                                           : kWindTimeout);
+        }));
+
+    heap_usage_ = free_heap_before - ESP.getFreeHeap();
+  }
+
+  /// Processed (motion compensated) apparent wind
+  sensesp::nmea0183::ApparentWindData* wind_data() { return wind_data_; }
+
+  /// Processed apparent wind as paired samples
+  WindSampleJoiner* wind_samples() { return wind_samples_; }
+
+  N2kWindDataSender* wind_data_sender() { return wind_data_sender_; }
+
+  SerialLink* serial_link() { return serial_link_; }
+
+  sensesp::nmea0183::NMEA0183IOTask* nmea0183_io_task() {
+    return nmea0183_io_task_;
+  }
+
+  AutonnicPATCWIMWVParser* response_parser() { return response_parser_; }
+
+  AdaptiveRateController* rate_controller() { return rate_controller_; }
+
+  const String& get_name() const { return name_; }
+
+  /// Heap allocated while constructing the instance, in bytes
+  sensesp::ObservableValue<int> heap_usage_ = 0;
+  /// Mean processing time of a received wind sample, in microseconds
+  sensesp::ObservableValue<float> processing_time_ = 0;
+
+ protected:
+  // Maximum time without wind sentences before the link is considered
+  // faulty, in ms
+  static constexpr unsigned long kWindTimeout = 2000;
+
+  String title(const char* item) { return name_ + " " + item; }
+
+  String name_;
+
+  sensesp::nmea0183::NMEA0183IOTask* nmea0183_io_task_;
+  sensesp::nmea0183::ApparentWindData* raw_wind_data_;
+  sensesp::nmea0183::ApparentWindData* wind_data_;
+  WindSampleJoiner* raw_wind_samples_;
+  WindSampleJoiner* wind_samples_;
+  AutonnicPATCWIMWVParser* response_parser_;
+  MastMotionCompensator* mast_motion_compensator_;
+  ReferenceAngleConfig* reference_angle_config_;
+  WindDirectionDampingConfig* wind_direction_damping_config_;
+  WindSpeedDampingConfig* wind_speed_damping_config_;
+  WindOutputRepetitionRateConfig* wind_output_repetition_rate_config_;
+  AdaptiveRateController* rate_controller_;
+  N2kWindDataSender* wind_data_sender_;
+  SerialLink* serial_link_;
+
+  // Forwards each complete raw sample to the processing chain and measures
+  // the time until all consumers, including those of wind_data(), are done
+  sensesp::ObservableValue<WindSample> timed_wind_samples_;
+  sensesp::LambdaConsumer<WindSample> processing_timer_{
+      [this](const WindSample& sample) {
+        unsigned long start = micros();
+        timed_wind_samples_.set(sample);
+        float elapsed = micros() - start;
+        // Exponential moving average over roughly 20 samples
+        processing_time_ = processing_time_.get() +
+                           0.05 * (elapsed - processing_time_.get());
+      }};
+};
+
+}  // namespace wind_interface
+
+#endif  // AUTONNIC_WIND_SRC_WIND_INSTRUMENT_H_
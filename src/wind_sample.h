@@ -0,0 +1,61 @@
+#ifndef AUTONNIC_WIND_SRC_WIND_SAMPLE_H_
+#define AUTONNIC_WIND_SRC_WIND_SAMPLE_H_
+
+#include "sensesp.h"
+#include "sensesp/system/lambda_consumer.h"
+#include "sensesp/system/valueproducer.h"
+#include "sensesp_nmea0183/data/wind_data.h"
+
+namespace wind_interface {
+
+/**
+ * @brief A single apparent wind sample.
+ */
+struct WindSample {
+  float speed = 0;  // m/s
+  float angle = 0;  // rad, 0 to 2*pi
+};
+
+/**
+ * @brief Pairs the separately emitted speed and angle values of
+ * ApparentWindData into WindSamples.
+ *
+ * A sample is emitted once both values have been received since the
+ * previous sample, i.e. on the value that completes the pair.
+ */
+class WindSampleJoiner : public sensesp::ValueProducer<WindSample> {
+ public:
+  WindSampleJoiner(sensesp::nmea0183::ApparentWindData* wind_data) {
+    wind_data->speed.connect_to(&speed_input_);
+    wind_data->angle.connect_to(&angle_input_);
+  }
+
+ protected:
+  void add_value() {
+    if (!has_speed_ || !has_angle_) {
+      return;
+    }
+    has_speed_ = false;
+    has_angle_ = false;
+    this->emit(sample_);
+  }
+
+  sensesp::LambdaConsumer<float> speed_input_{[this](float value) {
+    sample_.speed = value;
+    has_speed_ = true;
+    add_value();
+  }};
+  sensesp::LambdaConsumer<float> angle_input_{[this](float value) {
+    sample_.angle = value;
+    has_angle_ = true;
+    add_value();
+  }};
+
+  WindSample sample_;
+  bool has_speed_ = false;
+  bool has_angle_ = false;
+};
+
+}  // namespace wind_interface
+
+#endif  // AUTONNIC_WIND_SRC_WIND_SAMPLE_H_
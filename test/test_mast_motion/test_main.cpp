@@ -0,0 +1,153 @@
+// Replays a synthetic IMU and wind trace of a rolling and pitching boat
+// through the mast motion compensation.
+
+#include <unity.h>
+
+#include <cmath>
+
+#include "imu/mast_motion.h"
+
+using namespace wind_interface;
+
+namespace {
+
+constexpr float kGravity = 9.80665;
+constexpr float kMastHeight = 15;
+constexpr float kImuRate = 112.5;         // Hz
+constexpr uint32_t kWindInterval = 100;  // ms
+constexpr float kTrueSpeed = 8;           // m/s
+constexpr float kTrueAngle = 40 * M_PI / 180;
+constexpr float kHeel = 15 * M_PI / 180;
+
+// Boat attitude at time t, in seconds. Rolls 10 degrees around a steady
+// heel with a 5 s period and pitches 3 degrees with a 3 s period.
+float roll(float t) { return kHeel + 0.175f * sinf(2 * M_PI * t / 5); }
+float roll_rate(float t) {
+  return 0.175f * 2 * M_PI / 5 * cosf(2 * M_PI * t / 5);
+}
+float pitch_rate(float t) {
+  return 0.052f * 2 * M_PI / 3 * cosf(2 * M_PI * t / 3);
+}
+
+struct ReplayResult {
+  float raw_angle_rms;  // rad
+  float raw_speed_rms;  // m/s
+  float angle_rms;
+  float speed_rms;
+};
+
+/**
+ * Feed duration_s seconds of IMU samples and wind samples in time order.
+ * The measured wind is the true wind plus the masthead velocity at the
+ * sample time. Errors are evaluated over the last half of the replay.
+ */
+ReplayResult Replay(MotionAccumulator* motion, float duration_s,
+                    float gyro_bias = 0) {
+  MotionAccumulator::Snapshot previous = motion->snapshot();
+  double raw_angle_sq = 0, raw_speed_sq = 0, angle_sq = 0, speed_sq = 0;
+  int count = 0;
+  uint32_t imu_index = 0;
+  uint32_t end_ms = duration_s * 1000;
+  for (uint32_t time_ms = kWindInterval; time_ms <= end_ms;
+       time_ms += kWindInterval) {
+    float t = time_ms / 1000.0f;
+    // All IMU samples up to the wind sample
+    for (; imu_index / kImuRate <= t; imu_index++) {
+      float ti = imu_index / kImuRate;
+      float phi = roll(ti);
+      motion->add_sample(roll_rate(ti) + gyro_bias, pitch_rate(ti),
+                         -kGravity * sinf(phi), -kGravity * cosf(phi));
+    }
+
+    float forward = kTrueSpeed * cosf(kTrueAngle) - kMastHeight * pitch_rate(t);
+    float starboard =
+        kTrueSpeed * sinf(kTrueAngle) + kMastHeight * roll_rate(t);
+    float raw_speed = sqrtf(forward * forward + starboard * starboard);
+    float raw_angle = atan2f(starboard, forward);
+
+    MotionAccumulator::Snapshot current = motion->snapshot();
+    MastVelocity velocity;
+    TEST_ASSERT_TRUE(MeanMastVelocity(previous, current, kMastHeight,
+                                      &velocity));
+    previous = current;
+    float speed, angle;
+    CompensateMastMotion(raw_speed, raw_angle, velocity, &speed, &angle);
+
+    if (time_ms > end_ms / 2) {
+      raw_angle_sq += powf(remainderf(raw_angle - kTrueAngle, 2 * M_PI), 2);
+      raw_speed_sq += powf(raw_speed - kTrueSpeed, 2);
+      angle_sq += powf(remainderf(angle - kTrueAngle, 2 * M_PI), 2);
+      speed_sq += powf(speed - kTrueSpeed, 2);
+      count++;
+    }
+  }
+  return {(float)sqrt(raw_angle_sq / count), (float)sqrt(raw_speed_sq / count),
+          (float)sqrt(angle_sq / count), (float)sqrt(speed_sq / count)};
+}
+
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_compensation_removes_mast_motion() {
+  MotionAccumulator motion;
+  ReplayResult result = Replay(&motion, 120);
+  // The rolling masthead swings the apparent wind by many degrees
+  TEST_ASSERT_GREATER_THAN(0.15, result.raw_angle_rms);
+  // The mean IMU rate over the wind interval lags the instantaneous rate
+  // by half an interval, which leaves a small residual
+  TEST_ASSERT_LESS_THAN(0.2 * result.raw_angle_rms, result.angle_rms);
+  TEST_ASSERT_LESS_THAN(0.2 * result.raw_speed_rms, result.speed_rms);
+}
+
+void test_gyro_bias_is_removed() {
+  MotionAccumulator motion;
+  // 0.5 deg/s of bias would be 0.13 m/s of masthead velocity
+  ReplayResult biased = Replay(&motion, 600, 0.5 * M_PI / 180);
+  MotionAccumulator reference_motion;
+  ReplayResult reference = Replay(&reference_motion, 600);
+  TEST_ASSERT_FLOAT_WITHIN(0.005, reference.angle_rms, biased.angle_rms);
+  TEST_ASSERT_FLOAT_WITHIN(0.02, reference.speed_rms, biased.speed_rms);
+}
+
+void test_no_imu_samples() {
+  MotionAccumulator motion;
+  MotionAccumulator::Snapshot snapshot = motion.snapshot();
+  MastVelocity velocity;
+  TEST_ASSERT_FALSE(
+      MeanMastVelocity(snapshot, motion.snapshot(), kMastHeight, &velocity));
+}
+
+void test_heel_follows_gravity() {
+  MotionAccumulator motion;
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0, motion.heel());
+  Replay(&motion, 120);
+  // The rolling averages out around the steady heel
+  TEST_ASSERT_FLOAT_WITHIN(1 * M_PI / 180, kHeel, motion.heel());
+
+  MotionAccumulator port_motion;
+  for (int i = 0; i < 10000; i++) {
+    port_motion.add_sample(0, 0, kGravity * sinf(kHeel),
+                           -kGravity * cosf(kHeel));
+  }
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, -kHeel, port_motion.heel());
+}
+
+void test_compensate_stationary_mast() {
+  MastVelocity still = {0, 0};
+  float speed, angle;
+  CompensateMastMotion(5, 3 * M_PI / 2, still, &speed, &angle);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 5, speed);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 3 * M_PI / 2, angle);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_compensation_removes_mast_motion);
+  RUN_TEST(test_gyro_bias_is_removed);
+  RUN_TEST(test_no_imu_samples);
+  RUN_TEST(test_heel_follows_gravity);
+  RUN_TEST(test_compensate_stationary_mast);
+  return UNITY_END();
+}
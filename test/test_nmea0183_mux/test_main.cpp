@@ -0,0 +1,188 @@
+// NMEA0183Mux over loopback sockets: delivery, backpressure from a client
+// that does not read, and client disconnects.
+
+#include <unity.h>
+
+#include <string>
+
+#include "net/nmea0183_mux.h"
+
+using namespace wind_interface;
+
+namespace {
+
+constexpr uint16_t kTcpPort = 23456;
+constexpr uint16_t kUdpPort = 23457;
+const char kSentence[] = "$WIMWV,123.4,R,5.6,M,A*0F";
+
+NMEA0183Mux* mux;
+
+sockaddr_in LoopbackAddress(uint16_t port) {
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  return addr;
+}
+
+int ConnectClient(int receive_buffer = 0) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (receive_buffer > 0) {
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer,
+               sizeof(receive_buffer));
+  }
+  sockaddr_in addr = LoopbackAddress(kTcpPort);
+  TEST_ASSERT_EQUAL_INT(0, connect(fd, (sockaddr*)&addr, sizeof(addr)));
+  usleep(10000);
+  mux->poll();
+  return fd;
+}
+
+int BindUdp() {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in addr = LoopbackAddress(kUdpPort);
+  TEST_ASSERT_EQUAL_INT(0, bind(fd, (sockaddr*)&addr, sizeof(addr)));
+  timeval timeout = {1, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  return fd;
+}
+
+std::string Receive(int fd, size_t len) {
+  std::string data;
+  char buf[256];
+  while (data.size() < len) {
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) {
+      break;
+    }
+    data.append(buf, n);
+  }
+  return data;
+}
+
+}  // namespace
+
+void setUp() {
+  mux = new NMEA0183Mux();
+  TEST_ASSERT_TRUE(mux->begin(kTcpPort, kUdpPort, htonl(INADDR_LOOPBACK)));
+}
+
+void tearDown() { delete mux; }
+
+void test_forward_to_udp_and_tcp() {
+  int udp = BindUdp();
+  int tcp = ConnectClient();
+  TEST_ASSERT_EQUAL_INT(1, mux->get_num_clients());
+
+  mux->forward(kSentence, strlen(kSentence));
+  std::string expected = std::string(kSentence) + "\r\n";
+  char buf[128];
+  ssize_t n = recv(udp, buf, sizeof(buf), 0);
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(), std::string(buf, n).c_str());
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(),
+                           Receive(tcp, expected.size()).c_str());
+
+  // A line that already ends with a line feed is sent as is
+  mux->forward(expected.c_str(), expected.size());
+  n = recv(udp, buf, sizeof(buf), 0);
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(), std::string(buf, n).c_str());
+
+  close(tcp);
+  close(udp);
+}
+
+void test_slow_client_gets_whole_sentences() {
+  // A small receive buffer makes the client fall behind quickly
+  int slow = ConnectClient(1024);
+  int fast = ConnectClient();
+  TEST_ASSERT_EQUAL_INT(2, mux->get_num_clients());
+
+  // The slow client does not read while the sentences are forwarded. The
+  // fast client is drained after every sentence.
+  constexpr int kNumSentences = 200000;
+  std::string expected = std::string(kSentence) + "\r\n";
+  std::string fast_data;
+  char buf[4096];
+  for (int i = 0; i < kNumSentences; i++) {
+    mux->forward(kSentence, strlen(kSentence));
+    mux->poll();
+    ssize_t n = recv(fast, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n > 0) {
+      fast_data.append(buf, n);
+    }
+  }
+  fast_data += Receive(fast, kNumSentences * expected.size() -
+                                 fast_data.size());
+  TEST_ASSERT_EQUAL_size_t(kNumSentences * expected.size(),
+                           fast_data.size());
+
+  unsigned long dropped = mux->get_dropped_sentences();
+  TEST_ASSERT_GREATER_THAN(0, dropped);
+
+  // Drain the slow client, flushing its queue until nothing more arrives
+  std::string slow_data;
+  int idle = 0;
+  while (idle < 10) {
+    mux->poll();
+    ssize_t n = recv(slow, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n > 0) {
+      slow_data.append(buf, n);
+      idle = 0;
+    } else {
+      usleep(1000);
+      idle++;
+    }
+  }
+
+  // Only whole sentences, and every sentence is either delivered or
+  // counted as dropped
+  TEST_ASSERT_EQUAL_size_t(0, slow_data.size() % expected.size());
+  size_t lines = slow_data.size() / expected.size();
+  for (size_t i = 0; i < lines; i++) {
+    TEST_ASSERT_TRUE(slow_data.compare(i * expected.size(), expected.size(),
+                                       expected) == 0);
+  }
+  TEST_ASSERT_EQUAL_INT(kNumSentences, lines + dropped);
+
+  close(slow);
+  close(fast);
+}
+
+void test_disconnect_frees_slot() {
+  int clients[NMEA0183Mux::kMaxClients];
+  for (auto& fd : clients) {
+    fd = ConnectClient();
+  }
+  TEST_ASSERT_EQUAL_INT(NMEA0183Mux::kMaxClients, mux->get_num_clients());
+
+  // Clients beyond the limit are turned away
+  int extra = ConnectClient();
+  TEST_ASSERT_EQUAL_INT(NMEA0183Mux::kMaxClients, mux->get_num_clients());
+  TEST_ASSERT_EQUAL_size_t(0, Receive(extra, 1).size());
+  close(extra);
+
+  close(clients[0]);
+  usleep(10000);
+  mux->poll();
+  TEST_ASSERT_EQUAL_INT(NMEA0183Mux::kMaxClients - 1, mux->get_num_clients());
+
+  // Forwarding to a closed peer must not raise SIGPIPE
+  close(clients[1]);
+  for (int i = 0; i < 100; i++) {
+    mux->forward(kSentence, strlen(kSentence));
+  }
+  mux->poll();
+  TEST_ASSERT_EQUAL_INT(NMEA0183Mux::kMaxClients - 2, mux->get_num_clients());
+
+  for (int i = 2; i < NMEA0183Mux::kMaxClients; i++) {
+    close(clients[i]);
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_forward_to_udp_and_tcp);
+  RUN_TEST(test_slow_client_gets_whole_sentences);
+  RUN_TEST(test_disconnect_frees_slot);
+  return UNITY_END();
+}
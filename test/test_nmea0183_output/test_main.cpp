@@ -0,0 +1,225 @@
+// NMEA 0183 wind output: sentence encoding against reference sentences,
+// encoding throughput, and the upwash and heel corrections.
+
+#include <unity.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "output/nmea0183_encoder.h"
+#include "output/wind_correction.h"
+
+using namespace wind_interface;
+
+namespace {
+
+char buf[NMEA0183SentenceBuilder::kMaxLength];
+
+std::string Sentence(size_t len) { return std::string(buf, len); }
+
+// 9.7 knots
+constexpr float kSpeed = 9.7 / kMetersPerSecondToKnots;
+
+// Reference implementation with printf formatting
+std::string ReferenceMWV(float speed, float angle) {
+  char body[64];
+  snprintf(body, sizeof(body), "IIMWV,%.1f,R,%.1f,N,A", angle,
+           speed * kMetersPerSecondToKnots);
+  uint8_t checksum = 0;
+  for (const char* c = body; *c; c++) {
+    checksum ^= *c;
+  }
+  char sentence[80];
+  snprintf(sentence, sizeof(sentence), "$%s*%02X\r\n", body, checksum);
+  return sentence;
+}
+
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_mwv_reference_sentences() {
+  TEST_ASSERT_EQUAL_STRING("$IIMWV,45.0,R,9.7,N,A*02\r\n",
+                           Sentence(EncodeMWV(buf, kSpeed, 45)).c_str());
+  TEST_ASSERT_EQUAL_STRING("$IIMWV,,R,,N,V*2A\r\n",
+                           Sentence(EncodeMWV(buf, kSpeed, 45, false)).c_str());
+  // Angles that round up to 360.0 are sent as 0.0
+  TEST_ASSERT_EQUAL_STRING("$IIMWV,0.0,R,0.0,N,A*3D\r\n",
+                           Sentence(EncodeMWV(buf, 0, 359.96)).c_str());
+}
+
+void test_vwr_reference_sentences() {
+  // Port side winds are sent as L with the angle off the bow
+  TEST_ASSERT_EQUAL_STRING(
+      "$IIVWR,30.0,L,9.7,N,5.0,M,18.0,K*56\r\n",
+      Sentence(EncodeVWR(buf, kSpeed, 330)).c_str());
+}
+
+void test_mwv_matches_printf() {
+  for (int i = 0; i < 3600; i++) {
+    float angle = i * 0.1f + 0.013f;
+    float speed = i * 0.011f + 0.0013f;
+    std::string expected = ReferenceMWV(speed, angle);
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(),
+                             Sentence(EncodeMWV(buf, speed, angle)).c_str());
+  }
+}
+
+void test_encoding_throughput() {
+  constexpr int kNumSentences = 100000;
+  size_t total = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kNumSentences; i++) {
+    float angle = (i % 3600) * 0.1f;
+    total += EncodeMWV(buf, 5 + (i % 100) * 0.1f, angle);
+    total += EncodeVWR(buf, 5 + (i % 100) * 0.1f, angle);
+  }
+  auto elapsed = std::chrono::duration<double, std::micro>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  double per_sentence = elapsed / (2 * kNumSentences);
+  char message[64];
+  snprintf(message, sizeof(message), "%.3f us per sentence", per_sentence);
+  // Reported only; the time depends on the host and its load
+  TEST_MESSAGE(message);
+  TEST_ASSERT_GREATER_THAN(0, total);
+}
+
+void test_longest_sentence_fits() {
+  size_t len = EncodeVWR(buf, 999, 179.9);
+  TEST_ASSERT_LESS_OR_EQUAL(NMEA0183SentenceBuilder::kMaxLength, len);
+  TEST_ASSERT_EQUAL_CHAR('\n', buf[len - 1]);
+}
+
+void test_upwash_correction() {
+  WindCorrectionTable table;
+  // Points 2 and 3 are at 30 and 45 degrees
+  table.set_point(2, 2, 1.1);
+  table.set_point(3, 4, 1.2);
+
+  float speed = 10, angle = 37.5;
+  table.apply(&speed, &angle);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 40.5, angle);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 11.5, speed);
+
+  // Mirrored for port
+  speed = 10;
+  angle = 322.5;
+  table.apply(&speed, &angle);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 319.5, angle);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 11.5, speed);
+}
+
+void test_heel_geometric_correction() {
+  WindCorrectionTable table;
+  constexpr float kHeel = 20;
+  float cos_heel = cosf(kHeel * M_PI / 180);
+  for (float awa = 0; awa <= 180; awa += 7.5) {
+    // What the heeled sensor measures for a true apparent wind angle awa
+    float rad = awa * M_PI / 180;
+    float measured = fabsf(atan2f(sinf(rad) * cos_heel, cosf(rad))) * 180 /
+                     M_PI;
+    float measured_speed =
+        10 * sqrtf(cosf(rad) * cosf(rad) +
+                   sinf(rad) * cos_heel * sinf(rad) * cos_heel);
+
+    float speed = measured_speed, angle = measured;
+    table.apply(&speed, &angle, kHeel);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, awa, angle);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 10, speed);
+
+    // Mirrored for port, and the heel sign does not matter
+    speed = measured_speed;
+    angle = 360 - measured;
+    table.apply(&speed, &angle, -kHeel);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, fmodf(360 - awa, 360), angle);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 10, speed);
+  }
+
+  // No correction at 0, 90 and 180 degrees; it increases the angle when
+  // close-hauled and decreases it on a broad reach
+  const float kAngles[] = {0, 40, 90, 140, 180};
+  float offsets[5];
+  for (int i = 0; i < 5; i++) {
+    float speed = 10, angle = kAngles[i];
+    table.apply(&speed, &angle, kHeel);
+    offsets[i] = angle - kAngles[i];
+  }
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 0, offsets[0]);
+  TEST_ASSERT_GREATER_THAN(0.5, offsets[1]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 0, offsets[2]);
+  TEST_ASSERT_LESS_THAN(-0.5, offsets[3]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 0, offsets[4]);
+}
+
+void test_heel_residual_table() {
+  WindCorrectionTable geometric;
+  WindCorrectionTable table;
+  // Heel rows 2 and 3 are at 10 and 15 degrees, points 2 and 3 at 30 and
+  // 45 degrees of wind angle
+  table.set_heel_point(2, 2, 1, 0.9);
+  table.set_heel_point(2, 3, 2, 1.0);
+  table.set_heel_point(3, 2, 3, 0.8);
+  table.set_heel_point(3, 3, 4, 0.7);
+
+  // Bilinear between the four points, on top of the geometric correction
+  float speed = 10, angle = 37.5, geometric_speed = 10,
+        geometric_angle = 37.5;
+  table.apply(&speed, &angle, 12.5);
+  geometric.apply(&geometric_speed, &geometric_angle, 12.5);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 2.5, angle - geometric_angle);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 0.85, speed / geometric_speed);
+
+  // Mirrored for port
+  speed = geometric_speed = 10;
+  angle = geometric_angle = 322.5;
+  table.apply(&speed, &angle, -12.5);
+  geometric.apply(&geometric_speed, &geometric_angle, -12.5);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, -2.5, angle - geometric_angle);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 0.85, speed / geometric_speed);
+
+  // The residual depends on the wind angle
+  speed = geometric_speed = 10;
+  angle = geometric_angle = 120;
+  table.apply(&speed, &angle, 12.5);
+  geometric.apply(&geometric_speed, &geometric_angle, 12.5);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, geometric_angle, angle);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, geometric_speed, speed);
+
+  // Beyond the table, the last heel row applies
+  table.set_heel_point(6, 6, 6, 0.7);
+  speed = geometric_speed = 10;
+  angle = geometric_angle = 90;
+  table.apply(&speed, &angle, 40);
+  geometric.apply(&geometric_speed, &geometric_angle, 30);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 6, angle - geometric_angle);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 0.7, speed / geometric_speed);
+}
+
+void test_default_table_is_identity() {
+  WindCorrectionTable table;
+  for (float angle = 0; angle < 360; angle += 7.5) {
+    float speed = 10, corrected = angle;
+    table.apply(&speed, &corrected);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, angle, corrected);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5, 10, speed);
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_mwv_reference_sentences);
+  RUN_TEST(test_vwr_reference_sentences);
+  RUN_TEST(test_mwv_matches_printf);
+  RUN_TEST(test_encoding_throughput);
+  RUN_TEST(test_longest_sentence_fits);
+  RUN_TEST(test_upwash_correction);
+  RUN_TEST(test_heel_geometric_correction);
+  RUN_TEST(test_heel_residual_table);
+  RUN_TEST(test_default_table_is_identity);
+  return UNITY_END();
+}
@@ -0,0 +1,81 @@
+// Output rate selection: limits, output demand and variability driven
+// changes.
+
+#include <unity.h>
+
+#include <cmath>
+
+#include "rate/output_rate_policy.h"
+
+using namespace wind_interface;
+
+void setUp() {}
+void tearDown() {}
+
+void test_set_limits_clamps_interval() {
+  OutputRatePolicy policy;
+  TEST_ASSERT_EQUAL_UINT32(500, policy.interval());
+  policy.set_limits(125, 250);
+  TEST_ASSERT_EQUAL_UINT32(250, policy.interval());
+  policy.set_limits(1000, 1000);
+  TEST_ASSERT_EQUAL_UINT32(1000, policy.interval());
+}
+
+void test_no_demand_uses_slowest_level() {
+  OutputRatePolicy policy;
+  TEST_ASSERT_TRUE(policy.update(0, 5, 0));
+  TEST_ASSERT_EQUAL_UINT32(1000, policy.interval());
+  // Variability alone does not speed up the output
+  for (uint32_t t = 1000; t < 60000; t += 1000) {
+    policy.update(t, 5, 0);
+  }
+  TEST_ASSERT_EQUAL_UINT32(1000, policy.interval());
+}
+
+void test_variability_follows_demand_ceiling() {
+  OutputRatePolicy policy;
+  uint32_t t = 0;
+  // Steady wind with a 500 ms demand stays at 500 ms
+  for (; t < 30000; t += 1000) {
+    policy.update(t, 0.5, 500);
+  }
+  TEST_ASSERT_EQUAL_UINT32(500, policy.interval());
+
+  // Gusty wind with a 125 ms demand speeds up one level at a time
+  for (; t < 34000; t += 1000) {
+    policy.update(t, 2, 125);
+  }
+  TEST_ASSERT_EQUAL_UINT32(250, policy.interval());
+  for (; t < 60000; t += 1000) {
+    policy.update(t, 2, 125);
+  }
+  TEST_ASSERT_EQUAL_UINT32(125, policy.interval());
+
+  // A slower demand takes effect at once
+  policy.update(t, 2, 500);
+  TEST_ASSERT_EQUAL_UINT32(500, policy.interval());
+}
+
+void test_variability_is_rate_independent() {
+  // The same wind signal sampled at 8 Hz and at 1 Hz
+  WindVariability fast, slow;
+  for (uint32_t t = 0; t < 120000; t += 125) {
+    float speed = 8 + 1.5f * sinf(t * 0.00137f) * sinf(t * 0.0071f);
+    float angle = 0.7f + 0.1f * sinf(t * 0.0023f);
+    fast.add(t, speed, angle);
+    if (t % 1000 == 0) {
+      slow.add(t, speed, angle);
+    }
+  }
+  TEST_ASSERT_GREATER_THAN(0.5, fast.score());
+  TEST_ASSERT_FLOAT_WITHIN(0.25 * fast.score(), fast.score(), slow.score());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_set_limits_clamps_interval);
+  RUN_TEST(test_no_demand_uses_slowest_level);
+  RUN_TEST(test_variability_follows_demand_ceiling);
+  RUN_TEST(test_variability_is_rate_independent);
+  return UNITY_END();
+}
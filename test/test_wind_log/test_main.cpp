@@ -0,0 +1,187 @@
+// Round trip of wind samples through the log sector encoder and decoder.
+
+#include <unity.h>
+
+#include <cmath>
+#include <cstring>
+
+#include "logger/wind_log_format.h"
+
+using namespace wind_interface;
+
+namespace {
+
+constexpr uint32_t kBaseMs = 100000;
+
+uint8_t sector[WindLogFormat::kSectorSize];
+
+float Radians(float degrees) { return degrees * M_PI / 180; }
+
+// Angle difference folded into -pi..pi
+float AngleError(float a, float b) { return remainderf(a - b, 2 * M_PI); }
+
+// Decode the sector and return the largest time error against times
+uint32_t MaxTimeError(const uint32_t* times, int num_samples) {
+  WindLogDecoder decoder;
+  TEST_ASSERT_TRUE(decoder.begin(sector));
+  WindLogFormat::Sample sample;
+  uint32_t max_error = 0;
+  for (int i = 0; i < num_samples; i++) {
+    TEST_ASSERT_TRUE(decoder.next(&sample));
+    uint32_t time_ms = sample.time_ms + kBaseMs;
+    uint32_t error =
+        time_ms > times[i] ? time_ms - times[i] : times[i] - time_ms;
+    max_error = error > max_error ? error : max_error;
+  }
+  TEST_ASSERT_FALSE(decoder.next(&sample));
+  return max_error;
+}
+
+}  // namespace
+
+void setUp() { memset(sector, 0, sizeof(sector)); }
+void tearDown() {}
+
+void test_round_trip() {
+  // Slowly varying wind through north, a gust, and a rate change
+  constexpr int kNumSamples = 300;
+  uint32_t times[kNumSamples];
+  float speeds[kNumSamples];
+  float angles[kNumSamples];
+  uint32_t time_ms = kBaseMs;
+  for (int i = 0; i < kNumSamples; i++) {
+    time_ms += i < 200 ? 100 : 250;
+    times[i] = time_ms;
+    speeds[i] = 6 + 0.5f * sinf(i * 0.1f) + (i == 150 ? 3 : 0);
+    angles[i] = Radians(fmodf(350 + i * 0.2f + 360, 360));
+  }
+
+  WindLogEncoder encoder;
+  encoder.begin(sector, 7, 1700000000, kBaseMs);
+  TEST_ASSERT_TRUE(encoder.empty());
+  for (int i = 0; i < kNumSamples; i++) {
+    TEST_ASSERT_TRUE(encoder.add(times[i], speeds[i], angles[i]));
+  }
+  encoder.finish();
+
+  WindLogDecoder decoder;
+  TEST_ASSERT_TRUE(decoder.begin(sector));
+  TEST_ASSERT_EQUAL_UINT32(7, decoder.header().sequence);
+  TEST_ASSERT_EQUAL_UINT32(1700000000, decoder.header().epoch);
+  TEST_ASSERT_EQUAL_UINT32(kBaseMs, decoder.header().base_ms);
+  // Mostly one byte delta records
+  TEST_ASSERT_LESS_THAN(2 * kNumSamples, decoder.header().payload_len);
+
+  WindLogFormat::Sample sample;
+  for (int i = 0; i < kNumSamples; i++) {
+    TEST_ASSERT_TRUE(decoder.next(&sample));
+    TEST_ASSERT_EQUAL_UINT32(times[i] - kBaseMs, sample.time_ms);
+    TEST_ASSERT_FLOAT_WITHIN(0.051, speeds[i], sample.speed);
+    TEST_ASSERT_FLOAT_WITHIN(Radians(0.51), 0,
+                             AngleError(angles[i], sample.angle));
+  }
+  TEST_ASSERT_FALSE(decoder.next(&sample));
+}
+
+void test_period_drift() {
+  // The sensor runs at 101 ms instead of the initially assumed 100 ms
+  constexpr int kNumSamples = 300;
+  uint32_t times[kNumSamples];
+  WindLogEncoder encoder;
+  encoder.begin(sector, 1, 0, kBaseMs);
+  for (int i = 0; i < kNumSamples; i++) {
+    times[i] = kBaseMs + i * 101;
+    TEST_ASSERT_TRUE(encoder.add(times[i], 5, Radians(45)));
+  }
+  encoder.finish();
+
+  TEST_ASSERT_LESS_OR_EQUAL(25, MaxTimeError(times, kNumSamples));
+  // Once the period has been re-estimated from the actual interval, no
+  // further keyframes are needed
+  WindLogFormat::Header header;
+  TEST_ASSERT_TRUE(WindLogFormat::read_header(sector, &header));
+  TEST_ASSERT_EQUAL_INT(2 * WindLogFormat::kKeyframeSize + kNumSamples - 2,
+                        header.payload_len);
+}
+
+void test_timing_jitter() {
+  // 125 ms with up to 10 ms of jitter fits into delta records
+  constexpr int kNumSamples = 300;
+  uint32_t times[kNumSamples];
+  WindLogEncoder encoder;
+  encoder.begin(sector, 1, 0, kBaseMs);
+  for (int i = 0; i < kNumSamples; i++) {
+    times[i] = kBaseMs + i * 125 + (i * 7919) % 21 - 10;
+    TEST_ASSERT_TRUE(encoder.add(times[i], 5, Radians(45)));
+  }
+  encoder.finish();
+
+  TEST_ASSERT_LESS_OR_EQUAL(125 / 4, MaxTimeError(times, kNumSamples));
+  WindLogFormat::Header header;
+  TEST_ASSERT_TRUE(WindLogFormat::read_header(sector, &header));
+  TEST_ASSERT_LESS_THAN(kNumSamples + 5 * WindLogFormat::kKeyframeSize,
+                        header.payload_len);
+}
+
+void test_full_sector() {
+  WindLogEncoder encoder;
+  encoder.begin(sector, 1, 0, kBaseMs);
+  // Alternate between far apart values so that every sample is a keyframe
+  int added = 0;
+  uint32_t time_ms = kBaseMs;
+  while (encoder.add(time_ms, added % 2 ? 20 : 2, 0)) {
+    time_ms += 100;
+    added++;
+  }
+  TEST_ASSERT_EQUAL_INT(
+      WindLogFormat::kPayloadSize / WindLogFormat::kKeyframeSize, added);
+  encoder.finish();
+
+  WindLogDecoder decoder;
+  TEST_ASSERT_TRUE(decoder.begin(sector));
+  WindLogFormat::Sample sample;
+  int decoded = 0;
+  while (decoder.next(&sample)) {
+    TEST_ASSERT_FLOAT_WITHIN(0.01, decoded % 2 ? 20 : 2, sample.speed);
+    decoded++;
+  }
+  TEST_ASSERT_EQUAL_INT(added, decoded);
+}
+
+void test_partial_sector_copy() {
+  uint8_t buf[WindLogFormat::kSectorSize];
+  WindLogEncoder encoder;
+  encoder.begin(buf, 3, 0, kBaseMs);
+  encoder.add(kBaseMs + 10, 5, Radians(90));
+  encoder.add(kBaseMs + 110, 5.1, Radians(91));
+
+  // The working buffer has no header until the sector is finished
+  WindLogDecoder decoder;
+  TEST_ASSERT_FALSE(decoder.begin(buf));
+
+  encoder.copy_to(sector);
+  TEST_ASSERT_TRUE(decoder.begin(sector));
+  WindLogFormat::Sample sample;
+  TEST_ASSERT_TRUE(decoder.next(&sample));
+  TEST_ASSERT_TRUE(decoder.next(&sample));
+  TEST_ASSERT_EQUAL_UINT32(110, sample.time_ms);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 5.1, sample.speed);
+  TEST_ASSERT_FALSE(decoder.next(&sample));
+}
+
+void test_erased_sector_is_invalid() {
+  memset(sector, 0xFF, sizeof(sector));
+  WindLogDecoder decoder;
+  TEST_ASSERT_FALSE(decoder.begin(sector));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_period_drift);
+  RUN_TEST(test_timing_jitter);
+  RUN_TEST(test_full_sector);
+  RUN_TEST(test_partial_sector_copy);
+  RUN_TEST(test_erased_sector_is_invalid);
+  return UNITY_END();
+}
@@ -0,0 +1,309 @@
+// Wind stream subscriber slots: allocation, interval decimation and
+// non-blocking delivery with a subscriber that does not read.
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <unity.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "net/stream_slots.h"
+
+using namespace wind_interface;
+
+namespace {
+
+using SendResult = StreamSlots::SendResult;
+
+StreamSlots* slots;
+
+struct Delivery {
+  int fd;
+  std::string frame;
+};
+
+std::vector<Delivery> deliveries;
+std::vector<int> closed;
+int encode_calls;
+
+int Encode(unsigned long now, char* buffer, size_t size) {
+  encode_calls++;
+  return snprintf(buffer, size, "data:{\"t\":%lu}\n\n", now);
+}
+
+int Queue(unsigned long now) {
+  return slots->queue(now, [now](char* buffer, size_t size) {
+    return Encode(now, buffer, size);
+  });
+}
+
+/// Flush with a fake socket layer; fds in would_block and failing don't
+/// take the frame
+void Flush(const std::vector<int>& would_block = {},
+           const std::vector<int>& failing = {}) {
+  slots->flush(
+      [&](int fd, const char* buffer, size_t len) {
+        for (int blocked : would_block) {
+          if (fd == blocked) {
+            return SendResult::kWouldBlock;
+          }
+        }
+        for (int failed : failing) {
+          if (fd == failed) {
+            return SendResult::kFailed;
+          }
+        }
+        deliveries.push_back({fd, std::string(buffer, len)});
+        return SendResult::kSent;
+      },
+      [](int fd) { closed.push_back(fd); });
+}
+
+int CountDeliveries(int fd) {
+  int count = 0;
+  for (auto& delivery : deliveries) {
+    if (delivery.fd == fd) {
+      count++;
+    }
+  }
+  return count;
+}
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_DONTWAIT | MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = MSG_DONTWAIT;
+#endif
+
+/// Same socket handling as WindStream::send_work()
+SendResult SocketSend(int fd, const char* buffer, size_t len) {
+  ssize_t sent = send(fd, buffer, len, kSendFlags);
+  if (sent == (ssize_t)len) {
+    return SendResult::kSent;
+  }
+  if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    return SendResult::kWouldBlock;
+  }
+  return SendResult::kFailed;
+}
+
+std::string Drain(int fd) {
+  std::string data;
+  char buf[4096];
+  ssize_t n;
+  while ((n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+    data.append(buf, n);
+  }
+  return data;
+}
+
+/// Number of frames in data, or -1 if it contains a partial frame
+int CountFrames(const std::string& data) {
+  int count = 0;
+  size_t pos = 0;
+  while (pos < data.size()) {
+    if (data.compare(pos, 10, "data:{\"t\":") != 0) {
+      return -1;
+    }
+    size_t end = data.find("}\n\n", pos);
+    if (end == std::string::npos) {
+      return -1;
+    }
+    pos = end + 3;
+    count++;
+  }
+  return count;
+}
+
+}  // namespace
+
+void setUp() {
+  slots = new StreamSlots();
+  deliveries.clear();
+  closed.clear();
+  encode_calls = 0;
+}
+
+void tearDown() { delete slots; }
+
+void test_slot_allocation() {
+  StreamSlots::Slot* acquired[StreamSlots::kMaxSlots];
+  for (int i = 0; i < StreamSlots::kMaxSlots; i++) {
+    acquired[i] = slots->acquire(10 + i, 0);
+    TEST_ASSERT_NOT_NULL(acquired[i]);
+  }
+  TEST_ASSERT_EQUAL_INT(StreamSlots::kMaxSlots, slots->active_count());
+  TEST_ASSERT_NULL(slots->acquire(20, 0));
+
+  // A released slot is reused, but not while its last frame is queued
+  TEST_ASSERT_EQUAL_INT(StreamSlots::kMaxSlots, Queue(1000));
+  StreamSlots::release(acquired[1]);
+  TEST_ASSERT_EQUAL_INT(StreamSlots::kMaxSlots - 1, slots->active_count());
+  TEST_ASSERT_NULL(slots->acquire(20, 0));
+  Flush();
+  TEST_ASSERT_EQUAL_INT(0, CountDeliveries(11));
+  StreamSlots::Slot* reused = slots->acquire(20, 0);
+  TEST_ASSERT_TRUE(reused == acquired[1]);
+  TEST_ASSERT_EQUAL_INT(StreamSlots::kMaxSlots, slots->active_count());
+
+  // The new subscriber gets the next frame at once
+  TEST_ASSERT_EQUAL_INT(StreamSlots::kMaxSlots, Queue(1001));
+  Flush();
+  TEST_ASSERT_EQUAL_INT(1, CountDeliveries(20));
+}
+
+void test_interval_decimation() {
+  slots->acquire(10, 0);
+  slots->acquire(11, 500);
+  slots->acquire(12, 1000);
+
+  // 8 Hz samples for 4 seconds
+  for (unsigned long t = 10000; t < 14000; t += 125) {
+    Queue(t);
+    Flush();
+  }
+  TEST_ASSERT_EQUAL_INT(32, CountDeliveries(10));
+  TEST_ASSERT_EQUAL_INT(8, CountDeliveries(11));
+  TEST_ASSERT_EQUAL_INT(4, CountDeliveries(12));
+  // The frame is encoded once per sample, not once per subscriber
+  TEST_ASSERT_EQUAL_INT(32, encode_calls);
+  TEST_ASSERT_EQUAL_INT(0, slots->dropped());
+}
+
+void test_no_encoding_without_due_subscriber() {
+  TEST_ASSERT_EQUAL_INT(0, Queue(1000));
+  slots->acquire(10, 1000);
+  TEST_ASSERT_EQUAL_INT(1, Queue(1000));
+  TEST_ASSERT_EQUAL_INT(0, Queue(1500));
+  TEST_ASSERT_EQUAL_INT(1, encode_calls);
+}
+
+void test_pending_frame_is_dropped() {
+  slots->acquire(10, 0);
+  slots->acquire(11, 0);
+  Queue(1000);
+  Flush();
+  // The server task falls behind: only the first of three frames is sent
+  Queue(1125);
+  Queue(1250);
+  Queue(1375);
+  Flush();
+  TEST_ASSERT_EQUAL_INT(2, CountDeliveries(10));
+  TEST_ASSERT_EQUAL_STRING("data:{\"t\":1125}\n\n",
+                           deliveries.back().frame.c_str());
+  TEST_ASSERT_EQUAL_INT(4, slots->dropped());
+}
+
+void test_would_block_drops_frame_for_one_subscriber() {
+  slots->acquire(10, 0);
+  slots->acquire(11, 0);
+  for (unsigned long t = 1000; t < 2000; t += 125) {
+    Queue(t);
+    Flush({11});
+  }
+  TEST_ASSERT_EQUAL_INT(8, CountDeliveries(10));
+  TEST_ASSERT_EQUAL_INT(0, CountDeliveries(11));
+  TEST_ASSERT_EQUAL_INT(8, slots->dropped());
+  TEST_ASSERT_TRUE(closed.empty());
+
+  // The subscriber catches up again
+  Queue(2000);
+  Flush();
+  TEST_ASSERT_EQUAL_INT(1, CountDeliveries(11));
+}
+
+void test_failed_send_closes_subscriber() {
+  StreamSlots::Slot* failing = slots->acquire(10, 0);
+  slots->acquire(11, 0);
+  Queue(1000);
+  Flush({}, {10});
+  TEST_ASSERT_EQUAL_INT(1, (int)closed.size());
+  TEST_ASSERT_EQUAL_INT(10, closed[0]);
+
+  // No more frames until the session is gone, and the slot stays taken
+  TEST_ASSERT_EQUAL_INT(1, Queue(1125));
+  Flush({}, {10});
+  TEST_ASSERT_EQUAL_INT(1, (int)closed.size());
+  TEST_ASSERT_EQUAL_INT(2, CountDeliveries(11));
+  TEST_ASSERT_EQUAL_INT(2, slots->active_count());
+
+  StreamSlots::release(failing);
+  TEST_ASSERT_TRUE(slots->acquire(12, 0) == failing);
+  TEST_ASSERT_EQUAL_INT(2, Queue(1250));
+}
+
+void test_slow_subscriber_does_not_stall_others() {
+  // One subscriber never reads and has a small socket buffer, the others
+  // are drained after every flush
+  constexpr int kNumSubscribers = StreamSlots::kMaxSlots;
+  int server[kNumSubscribers];
+  int client[kNumSubscribers];
+  for (int i = 0; i < kNumSubscribers; i++) {
+    int pair[2];
+    TEST_ASSERT_EQUAL_INT(0, socketpair(AF_UNIX, SOCK_STREAM, 0, pair));
+    server[i] = pair[0];
+    client[i] = pair[1];
+    slots->acquire(server[i], 0);
+  }
+  int buffer_size = 4096;
+  setsockopt(server[0], SOL_SOCKET, SO_SNDBUF, &buffer_size,
+             sizeof(buffer_size));
+  setsockopt(client[0], SOL_SOCKET, SO_RCVBUF, &buffer_size,
+             sizeof(buffer_size));
+
+  constexpr int kNumFrames = 100000;
+  std::string received[kNumSubscribers];
+  auto start = std::chrono::steady_clock::now();
+  for (int frame = 0; frame < kNumFrames; frame++) {
+    slots->queue(frame, [frame](char* buffer, size_t size) {
+      return snprintf(buffer, size,
+                      "data:{\"t\":%d,\"s\":5.32,\"a\":0.7854}\n\n", frame);
+    });
+    slots->flush(SocketSend, [](int fd) { closed.push_back(fd); });
+    for (int i = 1; i < kNumSubscribers; i++) {
+      received[i] += Drain(client[i]);
+    }
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  received[0] = Drain(client[0]);
+
+  // The slow subscriber gets whole frames until its buffer is full, the
+  // others get every frame
+  int slow_frames = CountFrames(received[0]);
+  TEST_ASSERT_GREATER_THAN(0, slow_frames);
+  TEST_ASSERT_LESS_THAN(kNumFrames, slow_frames);
+  TEST_ASSERT_EQUAL_INT(kNumFrames - slow_frames, slots->dropped());
+  for (int i = 1; i < kNumSubscribers; i++) {
+    TEST_ASSERT_EQUAL_INT(kNumFrames, CountFrames(received[i]));
+  }
+  TEST_ASSERT_TRUE(closed.empty());
+
+  double seconds = std::chrono::duration<double>(elapsed).count();
+  char message[128];
+  snprintf(message, sizeof(message),
+           "%d subscribers, 1 stalled: %.0f frames/s per subscriber, "
+           "%d frames dropped",
+           kNumSubscribers, kNumFrames / seconds, slots->dropped());
+  TEST_MESSAGE(message);
+
+  for (int i = 0; i < kNumSubscribers; i++) {
+    close(server[i]);
+    close(client[i]);
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_slot_allocation);
+  RUN_TEST(test_interval_decimation);
+  RUN_TEST(test_no_encoding_without_due_subscriber);
+  RUN_TEST(test_pending_frame_is_dropped);
+  RUN_TEST(test_would_block_drops_frame_for_one_subscriber);
+  RUN_TEST(test_failed_send_closes_subscriber);
+  RUN_TEST(test_slow_subscriber_does_not_stall_others);
+  return UNITY_END();
+}